@@ -0,0 +1,33 @@
+#include <symmetri/symmetri.h>
+
+#include <iostream>
+
+// Compiles a set of PNML- or GRML-files to a binary net that can be loaded
+// with symmetri::loadTopology, e.g.:
+//   symmetri_compile_net net.symnet nets/PT1.pnml nets/PT2.pnml
+int main(int argc, char *argv[]) {
+  using namespace symmetri;
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <output> <net-file>..." << std::endl;
+    return -1;
+  }
+  const std::string output = argv[1];
+  const std::set<std::string> files(argv + 2, argv + argc);
+  const auto elapsed = [](Clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                                 begin)
+        .count();
+  };
+
+  auto begin = Clock::now();
+  const auto topology = createTopology(files);
+  std::cout << "parsed in " << elapsed(begin) << " [us]" << std::endl;
+
+  saveTopology(topology, output);
+
+  begin = Clock::now();
+  loadTopology(output);
+  std::cout << "loaded " << output << " in " << elapsed(begin) << " [us]"
+            << std::endl;
+  return 0;
+}
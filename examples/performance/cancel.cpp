@@ -0,0 +1,78 @@
+#include <symmetri/symmetri.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+// Measures the latency from calling cancel until fire returns, for a net that
+// fires a transition in a loop and for a net of which the Callback is such a
+// looping child net. Canceling the parent cancels the child, so fire only
+// returns once the child returned too.
+using namespace symmetri;
+
+// a transition that fires forever and flags that it did.
+PetriNet createLoop(const std::string &case_id,
+                    const std::shared_ptr<TaskSystem> &pool,
+                    const std::shared_ptr<std::atomic<bool>> &is_looping) {
+  PetriNet net({{"loop", {{{"Pa", Success}}, {{"Pa", Success}}}}}, case_id,
+               pool, {{"Pa", Success}}, {{"Pb", Success}});
+  net.registerCallback("loop", [is_looping] { is_looping->store(true); });
+  return net;
+}
+
+// a transition of which the Callback is a looping child net.
+PetriNet createParent(const std::string &case_id,
+                      const std::shared_ptr<TaskSystem> &pool,
+                      const std::shared_ptr<std::atomic<bool>> &is_looping) {
+  PetriNet net({{"child", {{{"Pa", Success}}, {{"Pb", Success}}}}}, case_id,
+               pool, {{"Pa", Success}}, {{"Pb", Success}});
+  net.registerCallback("child",
+                       createLoop(case_id + "_child", pool, is_looping));
+  return net;
+}
+
+void printPercentiles(const std::string &name,
+                      std::vector<Clock::duration> latencies) {
+  std::sort(latencies.begin(), latencies.end());
+  const auto percentile = [&](double p) {
+    const auto i = static_cast<size_t>(p * (latencies.size() - 1));
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(latencies[i])
+        .count();
+  };
+  std::cout << name << " [ns]: p50 " << percentile(0.5) << ", p90 "
+            << percentile(0.9) << ", p99 " << percentile(0.99) << ", max "
+            << percentile(1.0) << std::endl;
+}
+
+template <typename Create>
+std::vector<Clock::duration> measure(Create &&create, size_t runs,
+                                     const std::shared_ptr<TaskSystem> &pool) {
+  std::vector<Clock::duration> latencies;
+  latencies.reserve(runs);
+  for (size_t i = 0; i < runs; i++) {
+    auto is_looping = std::make_shared<std::atomic<bool>>(false);
+    const auto net = create("case_" + std::to_string(i), pool, is_looping);
+    Clock::time_point returned;
+    std::thread firing([&] {
+      fire(net);
+      returned = Clock::now();
+    });
+    while (!is_looping->load()) {
+      std::this_thread::yield();
+    }
+    const auto canceled = Clock::now();
+    cancel(net);
+    firing.join();
+    latencies.push_back(returned - canceled);
+  }
+  return latencies;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t runs = argc > 1 ? std::stoul(argv[1]) : 1000;
+  auto pool = std::make_shared<TaskSystem>(2);
+  printPercentiles("loop", measure(createLoop, runs, pool));
+  printPercentiles("child net", measure(createParent, runs, pool));
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <symmetri/reactor.h>
+#include <symmetri/symmetri.h>
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Fires many concurrent cases of a small net, once with a thread per case that
+// calls fire and once with a Reactor that drives all cases from a single
+// thread. The Callbacks of all cases run on the same pool in both variants.
+using namespace symmetri;
+
+std::shared_ptr<const Topology> createChain(size_t length) {
+  Net net;
+  for (size_t i = 0; i < length; i++) {
+    net["T" + std::to_string(i)] = {{{"P" + std::to_string(i), Success}},
+                                    {{"P" + std::to_string(i + 1), Success}}};
+  }
+  return createTopology(net, {{"P0", Success}},
+                        {{"P" + std::to_string(length), Success}});
+}
+
+std::vector<PetriNet> createCases(const std::shared_ptr<const Topology> &net,
+                                  size_t length, size_t count,
+                                  const std::shared_ptr<TaskSystem> &pool) {
+  std::vector<PetriNet> cases;
+  cases.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    cases.emplace_back(net, "case_" + std::to_string(i), pool);
+    for (size_t t = 0; t < length; t++) {
+      cases.back().registerCallback("T" + std::to_string(t), [] {});
+    }
+  }
+  return cases;
+}
+
+void print(const std::string &name, size_t count, Clock::time_point begin,
+           size_t successes) {
+  std::cout << name << ": " << count << " cases in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   Clock::now() - begin)
+                   .count()
+            << " [ms], " << successes << " successful" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000;
+  const size_t length = argc > 2 ? std::stoul(argv[2]) : 10;
+  const auto net = createChain(length);
+  auto pool = std::make_shared<TaskSystem>();
+
+  {
+    auto cases = createCases(net, length, count, pool);
+    std::atomic<size_t> successes{0};
+    const auto begin = Clock::now();
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (const auto &petri : cases) {
+      threads.emplace_back([&] { successes += fire(petri) == Success; });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    print("thread per case", count, begin, successes);
+  }
+
+  {
+    auto cases = createCases(net, length, count, pool);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t done = 0, successes = 0;
+    const auto begin = Clock::now();
+    Reactor reactor(1);
+    for (const auto &petri : cases) {
+      reactor.fire(petri, [&](Token result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done++;
+        successes += result == Success;
+        cv.notify_one();
+      });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return done == count; });
+    print("reactor", count, begin, successes);
+  }
+  return 0;
+}
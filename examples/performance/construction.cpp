@@ -0,0 +1,56 @@
+#include <symmetri/symmetri.h>
+
+#include <iostream>
+
+// Measures how long it takes to construct a PetriNet. The net is a ring of
+// transitions where every transition has a couple of input and output places,
+// so the size of the net grows linearly with the amount of transitions.
+symmetri::Net createNet(size_t transition_count) {
+  using namespace symmetri;
+  const auto place = [](size_t i) { return "P" + std::to_string(i); };
+  Net net;
+  net.reserve(transition_count);
+  for (size_t i = 0; i < transition_count; i++) {
+    const auto next = (i + 1) % transition_count;
+    net["T" + std::to_string(i)] = {
+        {{place(i), Success}, {place(i + transition_count), Success}},
+        {{place(next), Success}, {place(next + transition_count), Success}}};
+  }
+  return net;
+}
+
+int main(int argc, char *argv[]) {
+  using namespace symmetri;
+  auto pool = std::make_shared<TaskSystem>(1);
+  const size_t max_size = argc > 1 ? std::stoul(argv[1]) : 100000;
+  for (size_t size = 1000; size <= max_size; size *= 10) {
+    const auto net = createNet(size);
+    const Marking initial = {{"P0", Success},
+                             {"P" + std::to_string(size), Success}};
+    const auto begin = Clock::now();
+    PetriNet petri(net, "construction", pool, initial, {});
+    const auto end = Clock::now();
+    std::cout << size << " transitions, " << 2 * size << " places: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                       begin)
+                     .count()
+              << " [us]" << std::endl;
+  }
+
+  // cases that share a topology only allocate their run-time state.
+  const auto topology = createTopology(createNet(1000), {{"P0", Success}});
+  const size_t case_count = 10000;
+  std::vector<PetriNet> cases;
+  cases.reserve(case_count);
+  const auto begin = Clock::now();
+  for (size_t i = 0; i < case_count; i++) {
+    cases.emplace_back(topology, "case_" + std::to_string(i), pool);
+  }
+  const auto end = Clock::now();
+  std::cout << case_count << " cases of a shared topology: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                     begin)
+                   .count()
+            << " [us]" << std::endl;
+  return 0;
+}
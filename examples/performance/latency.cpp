@@ -0,0 +1,83 @@
+#include <symmetri/symmetri.h>
+
+#include <algorithm>
+#include <iostream>
+
+// Measures the latency of the firing loop for every WaitPolicy. The net is a
+// chain of transitions with short Callbacks, so every firing waits on two
+// hand-overs: the dispatch of the Callback to a thread of the pool and the
+// completion of the Callback back to the thread that fires the net.
+using namespace symmetri;
+
+Net createChain(size_t length) {
+  Net net;
+  for (size_t i = 0; i < length; i++) {
+    net["T" + std::to_string(i)] = {{{"P" + std::to_string(i), Success}},
+                                    {{"P" + std::to_string(i + 1), Success}}};
+  }
+  return net;
+}
+
+void printPercentiles(const std::string &name,
+                      std::vector<Clock::duration> latencies) {
+  std::sort(latencies.begin(), latencies.end());
+  const auto percentile = [&](double p) {
+    const auto i = static_cast<size_t>(p * (latencies.size() - 1));
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(latencies[i])
+        .count();
+  };
+  std::cout << "  " << name << " [ns]: p50 " << percentile(0.5) << ", p90 "
+            << percentile(0.9) << ", p99 " << percentile(0.99) << ", max "
+            << percentile(1.0) << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t length = argc > 1 ? std::stoul(argv[1]) : 10000;
+  const auto net = createChain(length);
+  const Marking initial = {{"P0", Success}};
+  const Marking goal = {{"P" + std::to_string(length), Success}};
+  const std::vector<std::pair<std::string, WaitPolicy>> policies = {
+      {"block", WaitPolicy::block()},
+      {"spin", WaitPolicy::spin()},
+      {"busy-poll", WaitPolicy::busyPoll()}};
+
+  for (const auto &[name, wait_policy] : policies) {
+    auto pool = std::make_shared<TaskSystem>(
+        1, TaskSystem::Scheduler::WorkStealing, wait_policy);
+    PetriNet petri(net, "latency", pool, initial, goal);
+    petri.setWaitPolicy(wait_policy);
+    for (size_t i = 0; i < length; i++) {
+      petri.registerCallback("T" + std::to_string(i), [] {});
+    }
+    const auto begin = Clock::now();
+    const auto result = fire(petri);
+    const auto end = Clock::now();
+
+    // the log of every firing is: scheduled, started, completed.
+    std::vector<Clock::duration> dispatch, completion;
+    const auto log = getLog(petri);
+    std::vector<Clock::time_point> scheduled(length), completed(length);
+    for (const auto &[case_id, t, state, time] : log) {
+      const auto i = std::stoul(t.substr(1));
+      if (state == Scheduled) {
+        scheduled[i] = time;
+        if (i > 0) {
+          completion.push_back(time - completed[i - 1]);
+        }
+      } else if (state == Started) {
+        dispatch.push_back(time - scheduled[i]);
+      } else {
+        completed[i] = time;
+      }
+    }
+    std::cout << name << ": " << length << " firings in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                       begin)
+                     .count()
+              << " [us], " << (result == Success ? "" : "not ")
+              << "successful" << std::endl;
+    printPercentiles("dispatch", dispatch);
+    printPercentiles("completion", completion);
+  }
+  return 0;
+}
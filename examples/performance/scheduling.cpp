@@ -0,0 +1,81 @@
+#include <symmetri/tasks.h>
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+
+// Compares the schedulers of the TaskSystem. Tasks busy-wait for the duration
+// of a typical Callback; they are either all pushed from the main thread, as
+// the firing thread of a net does, or pushed in batches from tasks, as nested
+// nets do.
+using namespace symmetri;
+using Duration = std::chrono::nanoseconds;
+
+void busyWait(Duration duration) {
+  const auto end = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+Duration run(TaskSystem::Scheduler scheduler, size_t thread_count,
+             size_t task_count, Duration duration, bool nested) {
+  auto pool = std::make_shared<TaskSystem>(thread_count, scheduler);
+  std::atomic<size_t> remaining(task_count);
+  std::promise<void> done;
+  const auto task = [&] {
+    busyWait(duration);
+    if (remaining.fetch_sub(1) == 1) {
+      done.set_value();
+    }
+  };
+  const size_t batch = 64;
+  const auto begin = std::chrono::steady_clock::now();
+  if (nested) {
+    for (size_t i = 0; i < task_count / batch; i++) {
+      pool->push([&] {
+        for (size_t j = 0; j < batch; j++) {
+          pool->push(task);
+        }
+      });
+    }
+  } else {
+    for (size_t i = 0; i < task_count; i++) {
+      pool->push(task);
+    }
+  }
+  done.get_future().wait();
+  return std::chrono::steady_clock::now() - begin;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t thread_count =
+      argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+  // the amount of tasks shrinks with their duration to bound the run time.
+  const std::vector<std::pair<Duration, size_t>> runs = {
+      {Duration(0), 64 * 1024},
+      {std::chrono::microseconds(1), 64 * 1024},
+      {std::chrono::microseconds(10), 16 * 1024},
+      {std::chrono::microseconds(100), 2 * 1024}};
+  std::cout << thread_count << " threads" << std::endl;
+  for (const bool nested : {false, true}) {
+    for (const auto &[duration, task_count] : runs) {
+      std::cout << (nested ? "nested, " : "external, ") << task_count
+                << " tasks of " << duration.count() << " [ns]:";
+      for (const auto scheduler : {TaskSystem::Scheduler::SharedQueue,
+                                   TaskSystem::Scheduler::WorkStealing}) {
+        const auto elapsed =
+            run(scheduler, thread_count, task_count, duration, nested);
+        std::cout << (scheduler == TaskSystem::Scheduler::SharedQueue
+                          ? " shared queue "
+                          : ", work stealing ")
+                  << std::chrono::duration_cast<std::chrono::microseconds>(
+                         elapsed)
+                         .count()
+                  << " [us]";
+      }
+      std::cout << std::endl;
+    }
+  }
+  return 0;
+}
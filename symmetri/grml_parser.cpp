@@ -1,10 +1,14 @@
 #include <map>
+#include <optional>
 #include <stdexcept>
 #include <string>
 
+#include "parser_utilities.h"
+#include "petri.h"
 #include "symmetri/colors.hpp"
 #include "symmetri/parsers.h"
 #include "tinyxml2/tinyxml2.h"
+#include "xml_stream.h"
 using namespace tinyxml2;
 
 namespace symmetri {
@@ -81,36 +85,167 @@ std::tuple<Net, Marking, PriorityTable> readGrml(
       const auto target_id =
           id_lookup_table[std::stoi(child->Attribute("target"))];
       const auto color = child->Attribute("color");
+      const auto arc_id = child->Attribute("id");
 
       const auto multiplicity = std::stoi(child->FirstChildElement("attribute")
                                               ->FirstChildElement("attribute")
                                               ->FirstChildElement("attribute")
                                               ->GetText());
 
-      for (int i = 0; i < multiplicity; i++) {
-        if (places.find(source_id) != places.end()) {
-          // if the source is a place, tokens are consumed.
-          const auto arc_color = NULL == color ? Success : Token(color);
-          if (state_net.find(target_id) != state_net.end()) {
-            state_net.find(target_id)->second.first.push_back(
-                {source_id, arc_color});
-          } else {
-            state_net.insert({target_id, {{{source_id, arc_color}}, {}}});
-          }
-        } else if (transitions.find(source_id) != transitions.end()) {
-          // if the destination is a place, tokens are produced.
-          if (state_net.find(source_id) != state_net.end()) {
-            state_net.find(source_id)->second.second.push_back(
-                {target_id, Success});
-          } else {
-            state_net.insert({source_id, {{}, {{target_id, Success}}}});
-          }
-        } else {
-          throw std::runtime_error(std::string(
-              "error: arc is not connecting a place to a transition."));
-        }
+      addArc(state_net, places, transitions, arc_id ? arc_id : "", source_id,
+             target_id, color, multiplicity);
+    }
+  }
+
+  return {state_net, place_initialMarking, priorities};
+}
+
+namespace {
+
+/**
+ * @brief An arc that is added to the net once the whole file is read; only
+ * then the nodes it refers to are known.
+ *
+ */
+struct PendingArc {
+  std::string id;  ///< empty if the arc has no id
+  int source;
+  int target;
+  std::optional<std::string> color;
+  int multiplicity;
+};
+
+/**
+ * @brief Collects the nodes and arcs of a grml-file while it is streamed.
+ *
+ */
+class GrmlHandler final : public XmlHandler {
+ public:
+  GrmlHandler(std::set<std::string> &places,
+              std::set<std::string> &transitions, PriorityTable &priorities,
+              std::map<int, std::string> &id_lookup_table, Marking &marking,
+              std::vector<PendingArc> &arcs)
+      : places_(places),
+        transitions_(transitions),
+        priorities_(priorities),
+        id_lookup_table_(id_lookup_table),
+        marking_(marking),
+        arcs_(arcs) {}
+
+  void startElement(std::string_view name,
+                    const XmlAttributes &attributes) override {
+    path_.emplace_back(name);
+    text_.clear();
+    const auto attribute = [&](std::string_view key) {
+      const auto value = findAttribute(attributes, key);
+      if (value == nullptr) {
+        throw std::runtime_error("error: <" + std::string(name) +
+                                 "> has no attribute " + std::string(key));
       }
+      return *value;
+    };
+    if (at({"node"})) {
+      node_type_ = attribute("nodeType");
+      node_id_ = std::stoi(attribute("id"));
+      node_name_.clear();
+      node_value_ = 0;
+    } else if (at({"node", "attribute"})) {
+      node_attribute_ = attribute("name");
+    } else if (at({"arc"})) {
+      const auto id = findAttribute(attributes, "id");
+      const auto color = findAttribute(attributes, "color");
+      arc_ = {id ? *id : std::string(), std::stoi(attribute("source")),
+              std::stoi(attribute("target")),
+              color ? std::optional<std::string>(*color) : std::nullopt, 1};
+    }
+  }
+
+  void endElement(std::string_view) override {
+    if (at({"node", "attribute"}) && node_attribute_ == "name") {
+      node_name_ = text_;
+    } else if (at({"node", "attribute", "attribute", "attribute"}) &&
+               (node_attribute_ == "marking" ||
+                node_attribute_ == "priority")) {
+      node_value_ = std::stoi(text_);
+    } else if (at({"node"})) {
+      addNode();
+    } else if (at({"arc", "attribute", "attribute", "attribute"})) {
+      arc_.multiplicity = std::stoi(text_);
+    } else if (at({"arc"})) {
+      arcs_.push_back(std::move(arc_));
+    }
+    path_.pop_back();
+  }
+
+  void text(std::string_view text) override { text_.append(text); }
+
+ private:
+  void addNode() {
+    if (node_type_ == "place") {
+      const auto initial_marking = static_cast<uint16_t>(node_value_);
+      for (int i = 0; i < initial_marking; i++) {
+        marking_.push_back({node_name_, Success});
+      }
+      places_.insert(node_name_);
+      id_lookup_table_.insert({node_id_, node_name_});
+    } else if (node_type_ == "transition") {
+      const auto priority = static_cast<int8_t>(node_value_);
+      transitions_.insert(node_name_);
+      id_lookup_table_.insert({node_id_, node_name_});
+      if (priority != 0) {
+        priorities_.push_back({node_name_, priority});
+      }
+    }
+  }
+
+  /**
+   * @brief Checks if the current element is at path relative to the model.
+   *
+   */
+  bool at(std::initializer_list<std::string_view> path) const {
+    return path_.size() == 1 + path.size() && path_[0] == "model" &&
+           std::equal(path.begin(), path.end(), path_.begin() + 1);
+  }
+
+  std::set<std::string> &places_;
+  std::set<std::string> &transitions_;
+  PriorityTable &priorities_;
+  std::map<int, std::string> &id_lookup_table_;
+  Marking &marking_;
+  std::vector<PendingArc> &arcs_;
+  std::vector<std::string> path_;
+  std::string text_;
+  std::string node_type_;
+  std::string node_name_;
+  std::string node_attribute_;
+  int node_id_ = 0;
+  int node_value_ = 0;
+  PendingArc arc_;
+};
+
+}  // namespace
+
+std::tuple<Net, Marking, PriorityTable> readGrmlStreaming(
+    const std::set<std::string> &files) {
+  std::set<std::string> places, transitions;
+  PriorityTable priorities;
+  std::map<int, std::string> id_lookup_table;
+
+  Marking place_initialMarking;
+  Net state_net;
+  std::vector<PendingArc> arcs;
+
+  for (auto file : files) {
+    GrmlHandler handler(places, transitions, priorities, id_lookup_table,
+                        place_initialMarking, arcs);
+    parseXml(file, handler);
+    for (const auto &arc : arcs) {
+      const auto color = arc.color ? arc.color->c_str() : nullptr;
+      addArc(state_net, places, transitions, arc.id,
+             id_lookup_table[arc.source], id_lookup_table[arc.target], color,
+             arc.multiplicity);
     }
+    arcs.clear();
   }
 
   return {state_net, place_initialMarking, priorities};
@@ -2,8 +2,10 @@
 
 /** @file callback.h */
 
+#include <functional>
 #include <memory>
 
+#include "symmetri/inline_function.h"
 #include "symmetri/types.h"
 
 namespace symmetri {
@@ -22,6 +24,30 @@ bool isSynchronous(const T &) {
   return false;
 }
 
+/**
+ * @brief Checks if the callback is deferred. A deferred callback is started
+ * by `fire(callback, completer)` and completes later by calling the
+ * Completer, so it does not occupy a thread of the TaskSystem while it waits.
+ * By default a callback is not deferred.
+ *
+ * @tparam T the type of the callback.
+ * @return true the callback completes through a Completer.
+ * @return false the callback completes when fire returns.
+ */
+template <typename T>
+bool isDeferred(const T &) {
+  return false;
+}
+
+/**
+ * @brief Completes a deferred callback with its result. It can be called from
+ * any thread, but only once. It is move-only and the Completer of a
+ * transition is stored inline, so completing a deferred callback does not
+ * allocate.
+ *
+ */
+using Completer = InlineFunction<void(Token), 48>;
+
 /**
  * @brief The default cancel implementation is naive. It only returns a
  * user-exit state and does nothing to the actual Callback itself, and it will
@@ -72,6 +98,19 @@ Token fire(const T &callback) {
   }
 }
 
+/**
+ * @brief Starts a deferred callback. The default implementation fires the
+ * callback and completes it right away.
+ *
+ * @tparam T the type of the callback.
+ * @param callback The function to be executed.
+ * @param completer is called with the result of the callback.
+ */
+template <typename T>
+void fire(const T &callback, Completer &&completer) {
+  completer(fire(callback));
+}
+
 /**
  * @brief Get the Log object. By default it returns an empty vector.
  *
@@ -109,12 +148,18 @@ class Callback {
   friend Token fire(const Callback &callback) {
     return callback.self_->fire_();
   }
+  friend void fire(const Callback &callback, Completer &&completer) {
+    return callback.self_->fire_(std::move(completer));
+  }
   friend Eventlog getLog(const Callback &callback) {
     return callback.self_->get_log_();
   }
   friend bool isSynchronous(const Callback &callback) {
     return callback.self_->is_synchronous_();
   }
+  friend bool isDeferred(const Callback &callback) {
+    return callback.self_->is_deferred_();
+  }
   friend void cancel(const Callback &callback) {
     return callback.self_->cancel_();
   }
@@ -129,17 +174,19 @@ class Callback {
   struct concept_t {
     virtual ~concept_t() = default;
     virtual Token fire_() const = 0;
+    virtual void fire_(Completer &&completer) const = 0;
     virtual Eventlog get_log_() const = 0;
     virtual void cancel_() const = 0;
     virtual void pause_() const = 0;
     virtual void resume_() const = 0;
     virtual bool is_synchronous_() const = 0;
+    virtual bool is_deferred_() const = 0;
   };
 
   /**
    * @brief A transition is defined by the concept that it is runnable,
-   * cancellable, pauseable and resumable. It can also be synchronous or
-   * asynchronous and queried for logs.
+   * cancellable, pauseable and resumable. It can also be synchronous,
+   * asynchronous or deferred and queried for logs.
    *
    * @tparam T the actual Callback contain business logic
    */
@@ -147,9 +194,13 @@ class Callback {
   struct model final : concept_t {
     model(Transition &&x) : transition_(std::move(x)) {}
     Token fire_() const override { return fire(transition_); }
+    void fire_(Completer &&completer) const override {
+      return fire(transition_, std::move(completer));
+    }
     Eventlog get_log_() const override { return getLog(transition_); }
     void cancel_() const override { return cancel(transition_); }
     bool is_synchronous_() const override { return isSynchronous(transition_); }
+    bool is_deferred_() const override { return isDeferred(transition_); }
     void pause_() const override { return pause(transition_); }
     void resume_() const override { return resume(transition_); }
     Transition transition_;
@@ -0,0 +1,336 @@
+#pragma once
+
+/** @file coroutine.h */
+
+#if !defined(__cpp_impl_coroutine)
+#error "symmetri/coroutine.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "symmetri/callback.h"
+#include "symmetri/tasks.h"
+
+namespace symmetri {
+
+/**
+ * @brief Control carries the cancel, pause and resume requests for a single
+ * run of a coroutine. A paused coroutine is parked at its next co_await until
+ * it is resumed or canceled.
+ *
+ */
+class Control {
+ public:
+  void cancel() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_canceled_ = true;
+    unpark(lock);
+  }
+
+  void pause() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_paused_ = true;
+  }
+
+  void resume() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_paused_ = false;
+    unpark(lock);
+  }
+
+  bool isCanceled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return is_canceled_;
+  }
+
+  /**
+   * @brief Parks the continuation of a coroutine if it is paused.
+   *
+   * @param continuation is called once the coroutine is resumed or canceled,
+   * on the thread that resumes or cancels it.
+   * @return true if the continuation is parked
+   */
+  bool park(std::function<void()> &&continuation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_paused_ && !is_canceled_) {
+      parked_ = std::move(continuation);
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  void unpark(std::unique_lock<std::mutex> &lock) {
+    auto parked = std::move(parked_);
+    parked_ = nullptr;
+    lock.unlock();
+    if (parked) {
+      parked();
+    }
+  }
+
+  mutable std::mutex mutex_;
+  bool is_canceled_ = false;
+  bool is_paused_ = false;
+  std::function<void()> parked_;
+};
+
+/**
+ * @brief AsyncToken is the return type of a coroutine that produces a Token
+ * with co_return. It starts suspended; it is started by a CoroutineCallback.
+ * Every co_await in the coroutine observes its Control: a canceled coroutine
+ * stops with the result Canceled as soon as it resumes from a co_await, and a
+ * paused coroutine waits at its next co_await until it is resumed. An
+ * exception that escapes the coroutine gives the result Failed.
+ *
+ */
+class AsyncToken {
+ public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  /**
+   * @brief Thrown from a co_await of a canceled coroutine, to unwind it.
+   *
+   */
+  struct Cancellation {};
+
+  /**
+   * @brief Wraps the awaiters of the coroutine, to apply its Control.
+   *
+   * @tparam Awaiter a type with await_ready, await_suspend and await_resume
+   */
+  template <typename Awaiter>
+  struct Controlled {
+    bool await_ready() {
+      return !promise.control->isCanceled() && awaiter.await_ready();
+    }
+
+    bool await_suspend(Handle handle) {
+      auto start = [this, handle] {
+        if (promise.control->isCanceled()) {
+          handle.resume();
+        } else if (!suspend(handle)) {
+          handle.resume();
+        }
+      };
+      if (promise.control->park(start)) {
+        return true;
+      } else if (promise.control->isCanceled()) {
+        return false;
+      }
+      return suspend(handle);
+    }
+
+    decltype(auto) await_resume() {
+      if (promise.control->isCanceled()) {
+        throw Cancellation{};
+      }
+      return awaiter.await_resume();
+    }
+
+    /**
+     * @brief Suspends through the wrapped awaiter.
+     *
+     * @return false if the coroutine has to continue immediately
+     */
+    bool suspend(Handle handle) {
+      using Result = decltype(awaiter.await_suspend(handle));
+      if constexpr (std::is_void_v<Result>) {
+        awaiter.await_suspend(handle);
+        return true;
+      } else if constexpr (std::is_same_v<Result, bool>) {
+        return awaiter.await_suspend(handle);
+      } else {
+        awaiter.await_suspend(handle).resume();
+        return true;
+      }
+    }
+
+    Awaiter awaiter;
+    promise_type &promise;
+  };
+
+  struct promise_type {
+    AsyncToken get_return_object() {
+      return AsyncToken(Handle::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+      struct Complete {
+        bool await_ready() noexcept { return false; }
+        void await_suspend(Handle handle) noexcept {
+          auto completer = std::move(handle.promise().completer);
+          const auto result = handle.promise().result;
+          handle.destroy();
+          completer(result);
+        }
+        void await_resume() noexcept {}
+      };
+      return Complete{};
+    }
+
+    void return_value(Token token) { result = token; }
+
+    void unhandled_exception() {
+      try {
+        throw;
+      } catch (const Cancellation &) {
+        result = Canceled;
+      } catch (...) {
+        result = Failed;
+      }
+    }
+
+    template <typename Awaiter>
+    Controlled<Awaiter> await_transform(Awaiter &&awaiter) {
+      return {std::forward<Awaiter>(awaiter), *this};
+    }
+
+    Token result = Success;
+    Completer completer;
+    std::shared_ptr<Control> control;
+  };
+
+  AsyncToken(AsyncToken &&other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr)) {}
+  AsyncToken &operator=(AsyncToken &&) = delete;
+  AsyncToken(const AsyncToken &) = delete;
+  AsyncToken &operator=(const AsyncToken &) = delete;
+  ~AsyncToken() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  /**
+   * @brief Runs the coroutine until its first suspension. The coroutine
+   * destroys itself once it is done, after it called the completer.
+   *
+   * @param control
+   * @param completer
+   */
+  void start(std::shared_ptr<Control> control, Completer &&completer) {
+    handle_.promise().control = std::move(control);
+    handle_.promise().completer = std::move(completer);
+    std::exchange(handle_, nullptr).resume();
+  }
+
+ private:
+  explicit AsyncToken(Handle handle) : handle_(handle) {}
+  Handle handle_;
+};
+
+/**
+ * @brief CoroutineCallback turns a function that returns an AsyncToken into
+ * a deferred Callback. The coroutine starts on a thread of the TaskSystem and
+ * does not hold that thread while it is suspended; it is resumed by whatever
+ * it awaits, e.g. on the TaskSystem through `resumeOn`. Canceling, pausing
+ * and resuming the Callback applies to all its runs.
+ *
+ * @tparam F a function without arguments that returns an AsyncToken
+ */
+template <typename F>
+class CoroutineCallback {
+  static_assert(std::is_same_v<std::invoke_result_t<const F &>, AsyncToken>,
+                "a CoroutineCallback is a function that returns an AsyncToken");
+
+ public:
+  explicit CoroutineCallback(F function)
+      : function_(std::move(function)), runs_(std::make_shared<Runs>()) {}
+
+  friend bool isDeferred(const CoroutineCallback &) { return true; }
+
+  friend void fire(const CoroutineCallback &callback, Completer &&completer) {
+    callback.function_().start(callback.runs_->add(), std::move(completer));
+  }
+
+  /**
+   * @brief Runs the coroutine and blocks until it is done.
+   *
+   */
+  friend Token fire(const CoroutineCallback &callback) {
+    std::promise<Token> result;
+    fire(callback, [&result](Token token) { result.set_value(token); });
+    return result.get_future().get();
+  }
+
+  friend void cancel(const CoroutineCallback &callback) {
+    callback.runs_->forEach([](Control &control) { control.cancel(); });
+  }
+  friend void pause(const CoroutineCallback &callback) {
+    callback.runs_->forEach([](Control &control) { control.pause(); });
+  }
+  friend void resume(const CoroutineCallback &callback) {
+    callback.runs_->forEach([](Control &control) { control.resume(); });
+  }
+
+ private:
+  /**
+   * @brief The Controls of the runs that are not done yet.
+   *
+   */
+  class Runs {
+   public:
+    std::shared_ptr<Control> add() {
+      auto control = std::make_shared<Control>();
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::erase_if(controls_, [](const auto &c) { return c.expired(); });
+      controls_.push_back(control);
+      return control;
+    }
+
+    template <typename G>
+    void forEach(G &&g) {
+      std::vector<std::shared_ptr<Control>> controls;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &c : controls_) {
+          if (auto control = c.lock()) {
+            controls.push_back(std::move(control));
+          }
+        }
+      }
+      // the Controls may resume coroutines, which is not done under the lock.
+      for (const auto &control : controls) {
+        g(*control);
+      }
+    }
+
+   private:
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<Control>> controls_;
+  };
+
+  F function_;
+  std::shared_ptr<Runs> runs_;
+};
+
+/**
+ * @brief An awaitable that continues the coroutine on a thread of a
+ * TaskSystem, e.g. after it was resumed by a thread that should not be
+ * occupied by the rest of the coroutine.
+ *
+ * @param pool
+ * @return auto
+ */
+inline auto resumeOn(const TaskSystem &pool) {
+  struct Awaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const {
+      pool.push([handle] { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+    const TaskSystem &pool;
+  };
+  return Awaiter{pool};
+}
+
+}  // namespace symmetri
@@ -0,0 +1,136 @@
+#pragma once
+
+/** @file inline_function.h */
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace symmetri {
+
+template <typename Signature, size_t Capacity>
+class InlineFunction;
+
+/**
+ * @brief InlineFunction is a move-only callable with the signature R(Args...).
+ * Callables of at most Capacity bytes are stored inside the InlineFunction,
+ * so creating, moving and calling it does not allocate. Larger callables, or
+ * callables that can throw while being moved, are stored on the heap instead.
+ *
+ * @tparam R the return type
+ * @tparam Args the argument types
+ * @tparam Capacity the amount of bytes that can be stored inline
+ */
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+  static_assert(Capacity >= sizeof(void *),
+                "the capacity must at least fit a pointer");
+
+ public:
+  static constexpr size_t capacity = Capacity;
+
+  InlineFunction() noexcept = default;
+  InlineFunction(std::nullptr_t) noexcept {}
+
+  /**
+   * @brief Construct a new InlineFunction object
+   *
+   * @tparam F the type of the callable
+   * @param f is the callable
+   */
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<std::decay_t<F>, InlineFunction>>>
+  InlineFunction(F &&f) {
+    using T = std::decay_t<F>;
+    if constexpr (isInline<T>()) {
+      new (&storage_) T(std::forward<F>(f));
+      vtable_ = &Inline<T>::vtable;
+    } else {
+      new (&storage_) T *(new T(std::forward<F>(f)));
+      vtable_ = &Heap<T>::vtable;
+    }
+  }
+
+  InlineFunction(InlineFunction &&other) noexcept { moveFrom(other); }
+  InlineFunction &operator=(InlineFunction &&other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+  InlineFunction &operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+  InlineFunction(const InlineFunction &) = delete;
+  InlineFunction &operator=(const InlineFunction &) = delete;
+  ~InlineFunction() noexcept { reset(); }
+
+  explicit operator bool() const noexcept { return vtable_ != nullptr; }
+
+  /**
+   * @brief Calls the callable. The InlineFunction must not be empty.
+   *
+   */
+  R operator()(Args... args) {
+    return vtable_->invoke(&storage_, std::forward<Args>(args)...);
+  }
+
+ private:
+  struct VTable {
+    R (*invoke)(void *, Args &&...);
+    void (*move)(void *from, void *to);  ///< also destroys from
+    void (*destroy)(void *);
+  };
+
+  template <typename T>
+  static constexpr bool isInline() {
+    return sizeof(T) <= Capacity && alignof(T) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible_v<T>;
+  }
+
+  template <typename T>
+  struct Inline {
+    static T &get(void *s) { return *std::launder(static_cast<T *>(s)); }
+    static R invoke(void *s, Args &&...args) {
+      return get(s)(std::forward<Args>(args)...);
+    }
+    static void move(void *from, void *to) {
+      new (to) T(std::move(get(from)));
+      get(from).~T();
+    }
+    static void destroy(void *s) { get(s).~T(); }
+    static constexpr VTable vtable = {&invoke, &move, &destroy};
+  };
+
+  template <typename T>
+  struct Heap {
+    static T *&get(void *s) { return *std::launder(static_cast<T **>(s)); }
+    static R invoke(void *s, Args &&...args) {
+      return (*get(s))(std::forward<Args>(args)...);
+    }
+    static void move(void *from, void *to) { new (to) T *(get(from)); }
+    static void destroy(void *s) { delete get(s); }
+    static constexpr VTable vtable = {&invoke, &move, &destroy};
+  };
+
+  void moveFrom(InlineFunction &other) noexcept {
+    if (other.vtable_ != nullptr) {
+      other.vtable_->move(&other.storage_, &storage_);
+      vtable_ = std::exchange(other.vtable_, nullptr);
+    }
+  }
+
+  void reset() noexcept {
+    if (vtable_ != nullptr) {
+      std::exchange(vtable_, nullptr)->destroy(&storage_);
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[Capacity];
+  const VTable *vtable_ = nullptr;
+};
+
+}  // namespace symmetri
@@ -15,7 +15,8 @@ namespace symmetri {
  * defined in multiple nets, the initial marking in the last processed net is
  * used. Note that this is kind of random because a set orders the files. It
  * will also register tokens for the color attributes that are in the arcs that
- * go from a place to a transition.
+ * go from a place to a transition. It throws a std::runtime_error if an arc
+ * does not connect a place to a transition or has a multiplicity less than 1.
  *
  * @param grml-files
  * @return std::tuple<Net, Marking,PriorityTable>
@@ -30,11 +31,35 @@ std::tuple<Net, Marking, PriorityTable> readGrml(
  * multiple nets, the initial marking in the last processed net is used. Note
  * that this is kind of random because a set orders the files. It will also
  * register tokens for the color attributes that are in the arcs that go from a
- * place to a transition.
+ * place to a transition. It throws a std::runtime_error if an arc does not
+ * connect a place to a transition or has a multiplicity less than 1.
  *
  * @param pnml-files
  * @return std::tuple<Net, Marking>
  */
 std::tuple<Net, Marking> readPnml(const std::set<std::string> &files);
 
+/**
+ * @brief Streaming variant of readGrml that gives the same result. Instead of
+ * loading every file into a DOM, the files are tokenized in fixed-size chunks
+ * and the net is built in a single pass, which keeps the memory overhead of
+ * parsing small for very large nets.
+ *
+ * @param grml-files
+ * @return std::tuple<Net, Marking,PriorityTable>
+ */
+std::tuple<Net, Marking, PriorityTable> readGrmlStreaming(
+    const std::set<std::string> &files);
+
+/**
+ * @brief Streaming variant of readPnml that gives the same result. Instead of
+ * loading every file into a DOM, the files are tokenized in fixed-size chunks
+ * and the net is built in a single pass, which keeps the memory overhead of
+ * parsing small for very large nets.
+ *
+ * @param pnml-files
+ * @return std::tuple<Net, Marking>
+ */
+std::tuple<Net, Marking> readPnmlStreaming(const std::set<std::string> &files);
+
 }  // namespace symmetri
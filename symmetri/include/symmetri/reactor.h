@@ -0,0 +1,86 @@
+#pragma once
+
+/** @file reactor.h */
+
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "symmetri/symmetri.h"
+
+namespace symmetri {
+
+/**
+ * @brief A Reactor fires many PetriNets on a few event-loop threads. Firing a
+ * PetriNet through `fire` blocks the calling thread until the net is done;
+ * a Reactor instead only processes a net when a message was sent to it, e.g.
+ * when one of its Callbacks completed, so a single thread can drive
+ * thousands of nets. The Callbacks of the nets are still executed by the
+ * TaskSystem of every net.
+ *
+ */
+class Reactor final {
+ public:
+  /**
+   * @brief Is called once a net is done, with the final state of the net. It
+   * is called on one of the threads of the Reactor, so it should not block.
+   * The net can be fired again from the handler.
+   *
+   */
+  using Handler = std::function<void(Token)>;
+
+  /**
+   * @brief Construct a new Reactor.
+   *
+   * @param thread_count the amount of event-loop threads, at least one
+   */
+  explicit Reactor(size_t thread_count = 1);
+
+  /**
+   * @brief Cancels the nets that are still fired and waits until they are
+   * done; their handlers are called as usual.
+   *
+   */
+  ~Reactor() noexcept;
+  Reactor(Reactor const &) = delete;
+  Reactor(Reactor &&) noexcept = delete;
+  Reactor &operator=(Reactor const &) = delete;
+  Reactor &operator=(Reactor &&) noexcept = delete;
+
+  /**
+   * @brief Starts firing a net and returns immediately. The net is fired like
+   * by `fire`, and can be canceled, paused and resumed in the same way, but
+   * its thread affinity is ignored. If the net is already fired, the handler
+   * is called immediately with Failed.
+   *
+   * @param net
+   * @param handler is called once the net is done
+   */
+  void fire(const PetriNet &net, Handler handler);
+
+  /**
+   * @brief The amount of nets that are fired and not yet done.
+   *
+   * @return size_t
+   */
+  size_t size() const;
+
+ private:
+  struct Core;
+  std::unique_ptr<Core> core_;  ///< The state that is shared with the nets
+                                ///< that are fired.
+};
+
+/**
+ * @brief Starts firing a net on a Reactor and returns immediately, so no
+ * thread is dedicated to the net. The fired net can be canceled, paused and
+ * resumed and its log can be queried like a net that is fired by `fire`.
+ *
+ * @param net
+ * @param reactor
+ * @return std::future<Token> the final state of the net, or Failed if the net
+ * was already fired
+ */
+std::future<Token> fireAsync(const PetriNet &net, Reactor &reactor);
+
+}  // namespace symmetri
@@ -18,6 +18,70 @@ namespace symmetri {
  */
 struct Petri;
 
+/**
+ * @brief Forward declaration of the immutable part of a Petri net. A Topology
+ * can be shared by many PetriNet objects that run the same model, which makes
+ * creating a new case cheap.
+ *
+ */
+struct Topology;
+
+/**
+ * @brief Forward declaration of the executor that fires many PetriNets on a
+ * few threads.
+ *
+ */
+class Reactor;
+
+/**
+ * @brief Create a Topology from a set of paths to PNML- or GRML-files. The
+ * initial marking is read from the files. Since PNML-files do not have
+ * priorities; you can optionally add a priority table manually.
+ *
+ * @param petri_net_xmls
+ * @param goal_marking
+ * @param priorities
+ * @return std::shared_ptr<const Topology>
+ */
+std::shared_ptr<const Topology> createTopology(
+    const std::set<std::string> &petri_net_xmls,
+    const Marking &goal_marking = {}, const PriorityTable &priorities = {});
+
+/**
+ * @brief Create a Topology from a net and initial marking.
+ *
+ * @param net
+ * @param initial_marking
+ * @param goal_marking
+ * @param priorities
+ * @return std::shared_ptr<const Topology>
+ */
+std::shared_ptr<const Topology> createTopology(
+    const Net &net, const Marking &initial_marking,
+    const Marking &goal_marking = {}, const PriorityTable &priorities = {});
+
+/**
+ * @brief Writes a Topology to a versioned binary file. The file holds the
+ * fully indexed net, so loading it does not require any parsing.
+ *
+ * @param topology
+ * @param path
+ */
+void saveTopology(const std::shared_ptr<const Topology> &topology,
+                  const std::string &path);
+
+/**
+ * @brief Loads a Topology from a file that was written by saveTopology. The
+ * file is memory-mapped and the arcs and names of the Topology are views on
+ * the mapped memory; on platforms without mmap the file is read into memory
+ * instead. It throws a std::runtime_error if the file can not be
+ * read or was written by an incompatible version.
+ *
+ * @param path
+ * @return std::shared_ptr<const Topology>
+ */
+std::shared_ptr<const Topology> loadTopology(const std::string &path);
+
 /**
  * @brief PetriNet exposes the possible constructors to create PetriNets. It
  * also allows the user to register a Callback to a transition, or to get a
@@ -57,6 +121,18 @@ class PetriNet final {
            const Marking &initial_marking, const Marking &goal_marking = {},
            const PriorityTable &priorities = {});
 
+  /**
+   * @brief Construct a new PetriNet object for a Topology that may be shared
+   * with other PetriNet objects. Only the run-time state of the case is
+   * allocated; Callbacks are registered per PetriNet.
+   *
+   * @param topology
+   * @param case_id
+   * @param threadpool
+   */
+  PetriNet(std::shared_ptr<const Topology> topology, const std::string &case_id,
+           std::shared_ptr<TaskSystem> threadpool);
+
   /**
    * @brief By registering a input transition you get a handle to manually force
    * a transition to fire. It returns a callable handle that will schedule a
@@ -79,6 +155,85 @@ class PetriNet final {
   void registerCallback(const std::string &transition,
                         const Callback &callback) const noexcept;
 
+  /**
+   * @brief Delays the Callback of a transition: when the transition fires its
+   * input tokens are consumed right away, but its Callback only starts once
+   * the delay expired. A pending delay is a timer in the loop that fires the
+   * net, so it does not occupy a thread. Pausing the net freezes its pending
+   * delays and canceling it drops them. Together with the default
+   * DirectMutation this makes a timed transition. Like registering a
+   * Callback, it has no effect while the net is fired.
+   *
+   * @param transition the name of transition
+   * @param delay
+   */
+  void setDelay(const std::string &transition,
+                Clock::duration delay) const noexcept;
+
+  /**
+   * @brief Bounds the time the asynchronous Callback of a transition may take,
+   * measured from the moment it is scheduled on the TaskSystem. If a run of
+   * the Callback did not complete when its deadline expires, the transition
+   * produces the timeout Token in its output places right away and the result
+   * of the run is ignored once it arrives. A run that did not start yet is
+   * dropped; a run that started is canceled, unless other runs of the same
+   * Callback are scheduled, as canceling a Callback cancels all its runs. In
+   * that case the run that timed out keeps running until it returns. Deadlines
+   * are frozen while the net is paused. Once the net is canceled, or reached
+   * its final state, an expired deadline no longer produces the timeout Token;
+   * it only bounds the wait for the run. Synchronous Callbacks, such as the
+   * default DirectMutation, run inline and have no deadline. Like registering
+   * a Callback, it has no effect while the net is fired.
+   *
+   * @param transition the name of transition
+   * @param deadline
+   * @param timeout the Token that is produced if the deadline expires
+   */
+  void setDeadline(const std::string &transition, Clock::duration deadline,
+                   const Token &timeout = Failed) const noexcept;
+
+  /**
+   * @brief Sets the way the thread that fires the net waits for completed
+   * Callbacks; by default it blocks. Like registering a Callback, it has no
+   * effect while the net is fired.
+   *
+   * @param wait_policy
+   */
+  void setWaitPolicy(const WaitPolicy &wait_policy) const noexcept;
+
+  /**
+   * @brief Pins the thread that fires the net to a set of CPUs while it fires
+   * the net; the previous affinity of the thread is restored when fire
+   * returns. An empty set disables pinning. Like registering a Callback, it has
+   * no effect while the net is fired, in which case the CPUs are not checked.
+   * Otherwise it throws a std::runtime_error if one of the CPUs is not
+   * available.
+   *
+   * @param cpus
+   */
+  void setFireAffinity(const std::vector<unsigned> &cpus) const;
+
+  /**
+   * @brief Sets the weight of the net in a TaskSystem with the FairShare
+   * scheduler: nets that have tasks queued get their tasks started in
+   * proportion to their weights, so a net that floods the TaskSystem does not
+   * starve the nets that share it. The weight is at least 1, which is the
+   * default. Other schedulers ignore it. It is thread-safe and can be changed
+   * while the net is fired.
+   *
+   * @param weight
+   */
+  void setShareWeight(unsigned weight) const noexcept;
+
+  /**
+   * @brief The statistics of the tasks the net queued on its TaskSystem. They
+   * are only tracked by the FairShare scheduler. It is thread-safe and can be
+   * called while the net is fired.
+   *
+   * @return Share::Stats
+   */
+  Share::Stats getQueueStats() const noexcept;
+
   /**
    * @brief Get the Marking object. This function is thread-safe and be called
    * during PetriNet execution.
@@ -103,6 +258,7 @@ class PetriNet final {
   friend void(symmetri::pause)(const PetriNet &);
   friend void(symmetri::resume)(const PetriNet &);
   friend Eventlog(symmetri::getLog)(const PetriNet &);
+  friend class Reactor;
 
  private:
   const std::shared_ptr<Petri> impl;  ///< Pointer to the implementation, all
@@ -3,19 +3,179 @@
 /** @file tasks.h */
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <new>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "symmetri/inline_function.h"
+
 namespace symmetri {
 
+/**
+ * @brief WaitPolicy determines how an idle thread waits for work: a thread of
+ * a TaskSystem waits for tasks and the thread that fires a net waits for
+ * completed Callbacks. Waking a blocked thread takes a system call, which can
+ * take longer than a short Callback; spinning avoids it at the cost of CPU
+ * time.
+ *
+ */
+struct WaitPolicy {
+  enum class Mode {
+    Block,    ///< block as soon as there is no work
+    Spin,     ///< poll spin_count times, then block
+    BusyPoll  ///< poll until there is work, never block
+  };
+
+  Mode mode;          ///< the way of waiting
+  size_t spin_count;  ///< the amount of polls before blocking if mode is Spin
+
+  static constexpr WaitPolicy block() { return {Mode::Block, 0}; }
+  static constexpr WaitPolicy spin(size_t spin_count = 4096) {
+    return {Mode::Spin, spin_count};
+  }
+  static constexpr WaitPolicy busyPoll() { return {Mode::BusyPoll, 0}; }
+
+  /**
+   * @brief The amount of polls before a waiting thread blocks.
+   *
+   * @return size_t
+   */
+  constexpr size_t pollCount() const {
+    return mode == Mode::Block  ? 0
+           : mode == Mode::Spin ? spin_count
+                                : std::numeric_limits<size_t>::max();
+  }
+
+  /**
+   * @brief Tells the CPU that the calling thread is polling, e.g. through the
+   * pause-instruction on x86.
+   *
+   */
+  static void relax() noexcept;
+};
+
+/**
+ * @brief Placement determines on which CPUs the threads of a TaskSystem run.
+ *
+ */
+struct Placement {
+  std::vector<unsigned> cpus;  ///< thread i is pinned to cpus[i % cpus.size()];
+                               ///< the threads are not pinned if it is empty
+  bool numa_aware = false;  ///< groups the threads per NUMA node. Tasks pushed
+                            ///< from outside the pool go to threads on the
+                            ///< node of the pushing thread and threads steal
+                            ///< from their own node first. If cpus is empty,
+                            ///< the threads are spread over all CPUs.
+};
+
+/**
+ * @brief The CPUs on which the calling thread is allowed to run.
+ *
+ * @return std::vector<unsigned>
+ */
+std::vector<unsigned> availableCpus();
+
+/**
+ * @brief The NUMA node of a CPU, as reported by /sys/devices/system/node. It
+ * is 0 on systems without NUMA information.
+ *
+ * @param cpu
+ * @return unsigned
+ */
+unsigned numaNode(unsigned cpu);
+
+/**
+ * @brief Pins the calling thread to a set of CPUs.
+ *
+ * @param cpus
+ * @return true if the thread is pinned, false if the set is empty or can not
+ * be applied
+ */
+bool setThreadAffinity(const std::vector<unsigned> &cpus) noexcept;
+
+/**
+ * @brief InlineTask is a move-only callable that takes no arguments and returns
+ * nothing, see InlineFunction.
+ *
+ * @tparam Capacity the amount of bytes that can be stored inline
+ */
+template <size_t Capacity>
+using InlineTask = InlineFunction<void(), Capacity>;
+
 /**
  * @brief forward declaration of the internal TaskQueue
  *
  */
 class TaskQueue;
 
+/**
+ * @brief A Share groups the tasks of one client of a TaskSystem, e.g. the
+ * Callbacks of a PetriNet. The FairShare scheduler gives every Share its own
+ * queue and divides the threads over the Shares that have queued tasks in
+ * proportion to their weights, so a client that pushes many tasks does not
+ * starve the others. The statistics of a Share are only maintained by the
+ * FairShare scheduler. It is thread-safe.
+ *
+ */
+class Share {
+ public:
+  /**
+   * @brief The queue-depth statistics of a Share.
+   *
+   */
+  struct Stats {
+    size_t queued;     ///< the amount of tasks that wait in the queue
+    size_t peak;       ///< the highest amount of queued tasks so far
+    uint64_t started;  ///< the amount of tasks that were taken from the queue
+  };
+
+  /**
+   * @brief Construct a new Share
+   *
+   * @param weight the relative amount of threads the Share gets, at least 1
+   */
+  explicit Share(unsigned weight = 1) noexcept;
+
+  /**
+   * @brief Changes the weight; it applies to the next task that is taken.
+   *
+   * @param weight at least 1
+   */
+  void setWeight(unsigned weight) noexcept;
+
+  unsigned weight() const noexcept;
+
+  Stats stats() const noexcept;
+
+  /**
+   * @brief Records that count tasks were queued. It is called by the queue
+   * of the TaskSystem.
+   *
+   * @param count
+   */
+  void recordPush(size_t count) noexcept;
+
+  /**
+   * @brief Records that a task was taken from the queue. It is called by the
+   * queue of the TaskSystem.
+   *
+   */
+  void recordTake() noexcept;
+
+ private:
+  std::atomic<unsigned> weight_;
+  std::atomic<size_t> queued_;
+  std::atomic<size_t> peak_;
+  std::atomic<uint64_t> started_;
+};
+
 /**
  * @brief Create a TaskSystem object. The only way to create a TaskSystem
  * is through this factory. We enforce the use of a smart pointer to make sure
@@ -24,20 +184,50 @@ class TaskQueue;
  *
  * @param thread_count the amount of threads in the pool. The simplest way to
  * avoid deadlocks in the net is to make sure thread_count is at least the
- * maximum amount of transitions in the net. are ran in parallel.
+ * maximum amount of transitions in the net that run in parallel. Transitions
+ * with a deferred Callback, such as the coroutines of coroutine.h, do not
+ * count, as they do not hold a thread while they wait.
  * @return std::shared_ptr<const TaskSystem>
  */
 class TaskSystem {
  public:
-  using Task = std::function<void()>;
+  /**
+   * @brief The tasks of the TaskSystem. The capacity fits the task that is
+   * pushed when a transition fires, so firing does not allocate.
+   *
+   */
+  using Task = InlineTask<64>;
+
+  /**
+   * @brief The way tasks are distributed over the threads of the pool.
+   *
+   */
+  enum class Scheduler {
+    SharedQueue,  ///< all threads take their tasks from lock-free queues per
+                  ///< priority that they share
+    WorkStealing,  ///< every thread has its own queue and steals from the
+                   ///< queues of other threads once it runs out of tasks
+    FairShare  ///< every Share has its own queue; the threads take tasks from
+               ///< the Shares in proportion to their weights
+  };
 
   /**
    * @brief Construct a new Task System object with n threads
    *
    * @param n_threads if less then 1, it defaults to
    * std::thread::hardware_concurrency()
+   * @param scheduler the way tasks are distributed over the threads. With
+   * WorkStealing a task that is pushed from one of the threads of the pool,
+   * e.g. by the Callback of a nested net, is queued on that same thread.
+   * @param wait_policy the way threads without tasks wait for new tasks
+   * @param placement the CPUs the threads run on. It throws a
+   * std::runtime_error if one of the CPUs is not available. NUMA-awareness
+   * only affects the WorkStealing scheduler.
    */
-  explicit TaskSystem(size_t n_threads = std::thread::hardware_concurrency());
+  explicit TaskSystem(size_t n_threads = std::thread::hardware_concurrency(),
+                      Scheduler scheduler = Scheduler::SharedQueue,
+                      WaitPolicy wait_policy = WaitPolicy::block(),
+                      const Placement& placement = {});
   ~TaskSystem() noexcept;
   TaskSystem(TaskSystem const&) = delete;
   TaskSystem(TaskSystem&&) noexcept = delete;
@@ -48,14 +238,33 @@ class TaskSystem {
    * @brief push tasks the queue for later execution on the thread pool.
    *
    * @param p
+   * @param priority tasks with a higher priority are executed first. Waiting
+   * tasks age, so tasks with a low priority are delayed but not starved.
+   * The WorkStealing scheduler orders the tasks per thread and the FairShare
+   * scheduler only orders the tasks of the same Share by priority.
+   * @param share the Share the task belongs to, only used by the FairShare
+   * scheduler. Tasks without a Share belong to a default Share of weight 1.
    */
-  void push(Task&& p) const;
+  void push(Task&& p, int priority = 0,
+            const std::shared_ptr<Share>& share = nullptr) const;
+
+  /**
+   * @brief push count tasks to the queue at once. This is cheaper than
+   * pushing them one by one: the queues are accessed once per batch and idle
+   * threads are woken together.
+   *
+   * @param tasks points to the first task; the tasks are moved from
+   * @param count the amount of tasks
+   * @param priority the priority of all tasks, as in push
+   * @param share the Share of all tasks, as in push
+   */
+  void pushBulk(Task* tasks, size_t count, int priority = 0,
+                const std::shared_ptr<Share>& share = nullptr) const;
 
  private:
-  void loop();
-  std::vector<std::thread> pool_;
-  std::atomic<bool> is_running_;
+  void loop(size_t worker);
   std::unique_ptr<TaskQueue> queue_;
+  std::vector<std::thread> pool_;
 };
 
 }  // namespace symmetri
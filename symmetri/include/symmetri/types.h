@@ -32,16 +32,29 @@ struct Event {
 using Eventlog = std::vector<Event>;  ///< The eventlog is simply a log of
                                       ///< events, sorted by their stamp
 
+/**
+ * @brief An Arc connects a place with a transition. When the transition fires,
+ * weight tokens of the color are consumed from an input place, or produced in
+ * an output place. An arc with weight n is equivalent to n arcs with weight 1.
+ *
+ */
+struct Arc {
+  Place place;          ///< The place the arc connects to
+  Token color;          ///< The color of the tokens
+  uint32_t weight = 1;  ///< The multiplicity of the arc, at least 1
+};
+
+bool operator==(const Arc &lhs, const Arc &rhs);
+
 using Net = std::unordered_map<
     Transition,
-    std::pair<std::vector<std::pair<Place, Token>>,
-              std::vector<std::pair<Place, Token>>>>;  ///< This is the multiset
-                                                       ///< definition of a
-                                                       ///< Petri net. For each
-                                                       ///< transition there is
-                                                       ///< a pair of lists for
-                                                       ///< colored input and
-                                                       ///< output places
+    std::pair<std::vector<Arc>, std::vector<Arc>>>;  ///< This is the multiset
+                                                     ///< definition of a Petri
+                                                     ///< net. For each
+                                                     ///< transition there is a
+                                                     ///< pair of lists for
+                                                     ///< colored input and
+                                                     ///< output arcs
 
 using Marking =
     std::vector<std::pair<Place, Token>>;  ///< The Marking is a vector pairs in
@@ -66,7 +66,8 @@ bool MarkingReached(const std::vector<T>& marking,
 
 /**
  * @brief Checks if two petri-nets have equal amount of arcs between places
- * and transitions of the same name.
+ * and transitions of the same name. Arcs are compared by their total weight,
+ * so an arc with weight 2 is equal to two arcs with weight 1.
  *
  * @param net1
  * @param net2
@@ -0,0 +1,403 @@
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <stdexcept>
+
+#include "petri.h"
+#include "symmetri/symmetri.h"
+
+namespace symmetri {
+
+namespace {
+
+/**
+ * @brief The version of the binary format. It must be incremented whenever
+ * the layout of the file or of the types that are stored in it changes.
+ *
+ */
+constexpr uint32_t kVersion = 1;
+constexpr std::array<char, 8> kMagic = {'S', 'Y', 'M', 'N', 'E', 'T', 0, 0};
+constexpr uint32_t kByteOrder = 0x01020304;
+
+/**
+ * @brief The header of a binary net. It is followed by the sections in the
+ * order in which they are listed in saveTopology; every section starts at a
+ * multiple of 8 bytes so that it can be used in place.
+ *
+ */
+struct Header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t arc_size;
+  uint32_t transition_count;
+  uint32_t place_count;
+  uint32_t color_count;
+  uint32_t input_count;
+  uint32_t output_count;
+  uint32_t reverse_count;
+  uint32_t initial_count;
+  uint32_t final_count;
+  uint32_t names_size;
+};
+
+/**
+ * @brief A single colored place of a marking.
+ *
+ */
+struct MarkingEntry {
+  uint32_t place;
+  uint32_t color;  ///< the index of the color in the process that saved it
+  uint64_t count;
+};
+
+static_assert(std::is_trivially_copyable_v<SmallArc>,
+              "SmallArc is used in place in the mapped file");
+static_assert(sizeof(Header) % 8 == 0 && sizeof(MarkingEntry) % 8 == 0);
+
+constexpr size_t align(size_t n) { return (n + 7) & ~size_t(7); }
+
+std::vector<MarkingEntry> toEntries(const TokenCounts &tokens) {
+  std::vector<MarkingEntry> entries;
+  for (size_t p = 0; p < tokens.size(); p++) {
+    for (const auto &[c, n] : tokens[p]) {
+      entries.push_back({static_cast<uint32_t>(p),
+                         static_cast<uint32_t>(c.toIndex()), n});
+    }
+  }
+  return entries;
+}
+
+class Writer {
+ public:
+  explicit Writer(const std::string &path)
+      : out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+      throw std::runtime_error("can not open '" + path + "' for writing");
+    }
+  }
+
+  template <typename T>
+  void write(Span<T> values) {
+    const auto size = values.size() * sizeof(T);
+    out_.write(reinterpret_cast<const char *>(values.begin()), size);
+    static const std::array<char, 8> padding{};
+    out_.write(padding.data(), align(size) - size);
+  }
+
+  template <typename T>
+  void write(const T &value) {
+    write(Span<T>(&value, &value + 1));
+  }
+
+ private:
+  std::ofstream out_;
+};
+
+class Reader {
+ public:
+  Reader(const char *data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  Span<T> read(size_t count) {
+    const auto size = count * sizeof(T);
+    if (size_ - offset_ < size) {
+      throw std::runtime_error("binary net is truncated");
+    }
+    const auto begin = reinterpret_cast<const T *>(data_ + offset_);
+    offset_ = std::min(size_, offset_ + align(size));
+    return {begin, begin + count};
+  }
+
+ private:
+  const char *data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+/**
+ * @brief Checks that the offsets of a Csr are ascending and end at the amount
+ * of values, and that every value is a valid index.
+ *
+ */
+template <typename T, typename F>
+void validate(Span<uint32_t> offsets, Span<T> values, F &&is_valid) {
+  const bool ascending =
+      std::is_sorted(offsets.begin(), offsets.end()) && offsets[0] == 0 &&
+      offsets[offsets.size() - 1] == values.size();
+  if (!ascending || !std::all_of(values.begin(), values.end(), is_valid)) {
+    throw std::runtime_error("binary net is corrupt");
+  }
+}
+
+/**
+ * @brief Checks that the place-to-transition lookup lists, for every place,
+ * exactly the transitions that consume from it, in the order in which
+ * createReversePlaceToTransitionLookup lists them. The inputs of a transition
+ * must be ordered by place.
+ *
+ */
+void validateReverse(Span<uint32_t> input_offsets, Span<SmallArc> inputs,
+                     Span<uint32_t> reverse_offsets, Span<uint32_t> reverse) {
+  const auto corrupt = [] {
+    throw std::runtime_error("binary net is corrupt");
+  };
+  std::vector<uint32_t> next(reverse_offsets.begin(),
+                             reverse_offsets.end() - 1);
+  for (size_t t = 0; t + 1 < input_offsets.size(); t++) {
+    for (auto i = input_offsets[t]; i < input_offsets[t + 1]; i++) {
+      const auto p = inputs[i].place;
+      if (i > input_offsets[t] && inputs[i - 1].place > p) {
+        corrupt();
+      } else if (i > input_offsets[t] && inputs[i - 1].place == p) {
+        continue;
+      } else if (next[p] == reverse_offsets[p + 1] || reverse[next[p]] != t) {
+        corrupt();
+      }
+      next[p]++;
+    }
+  }
+  for (size_t p = 0; p < next.size(); p++) {
+    if (next[p] != reverse_offsets[p + 1]) {
+      corrupt();
+    }
+  }
+}
+
+/**
+ * @brief Maps a file into memory. On platforms without mmap the file is read
+ * into an 8-byte aligned buffer instead. It throws a std::runtime_error if
+ * the file can not be read or is empty.
+ *
+ * @param path
+ * @param size is assigned the size of the file
+ * @return std::shared_ptr<const void> the contents of the file
+ */
+std::shared_ptr<const void> readFile(const std::string &path, size_t &size) {
+#if defined(__unix__) || defined(__APPLE__)
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("can not open '" + path + "'");
+  }
+  struct stat info;
+  const bool has_size = ::fstat(fd, &info) == 0 && info.st_size > 0;
+  void *address =
+      has_size ? ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)
+               : MAP_FAILED;
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("can not map '" + path + "'");
+  }
+  size = info.st_size;
+  return std::shared_ptr<const void>(address, [size](const void *p) {
+    ::munmap(const_cast<void *>(p), size);
+  });
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    throw std::runtime_error("can not open '" + path + "'");
+  }
+  size = static_cast<size_t>(file.tellg());
+  std::shared_ptr<uint64_t> buffer(new uint64_t[(size + 7) / 8],
+                                   std::default_delete<uint64_t[]>());
+  file.seekg(0);
+  if (size == 0 || !file.read(reinterpret_cast<char *>(buffer.get()), size)) {
+    throw std::runtime_error("can not read '" + path + "'");
+  }
+  return buffer;
+#endif
+}
+
+}  // namespace
+
+void saveTopology(const std::shared_ptr<const Topology> &topology,
+                  const std::string &path) {
+  const auto &net = *topology;
+  const auto initial = toEntries(net.initial_tokens);
+  const auto final = toEntries(net.final_marking);
+
+  // the colors that are used in the net, stored by name.
+  std::vector<Token> colors;
+  const auto add_color = [&](const Token &c) {
+    if (std::find(colors.begin(), colors.end(), c) == colors.end()) {
+      colors.push_back(c);
+    }
+  };
+  for (const auto &csr : {&net.input_n, &net.output_n}) {
+    for (const auto &arc : csr->values()) {
+      add_color(arc.color);
+    }
+  }
+  for (const auto &tokens : {&net.initial_tokens, &net.final_marking}) {
+    for (const auto &colored_place : *tokens) {
+      for (const auto &[c, n] : colored_place) {
+        add_color(c);
+      }
+    }
+  }
+
+  std::vector<uint32_t> color_indices;
+  std::vector<uint32_t> name_offsets = {0};
+  std::string names;
+  const auto add_name = [&](std::string_view name) {
+    names.append(name);
+    name_offsets.push_back(static_cast<uint32_t>(names.size()));
+  };
+  for (const auto &t : net.transition) {
+    add_name(t);
+  }
+  for (const auto &p : net.place) {
+    add_name(p);
+  }
+  for (const auto &c : colors) {
+    color_indices.push_back(static_cast<uint32_t>(c.toIndex()));
+    add_name(c.toString());
+  }
+
+  Header header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.arc_size = sizeof(SmallArc);
+  header.transition_count = static_cast<uint32_t>(net.transition.size());
+  header.place_count = static_cast<uint32_t>(net.place.size());
+  header.color_count = static_cast<uint32_t>(colors.size());
+  header.input_count = static_cast<uint32_t>(net.input_n.values().size());
+  header.output_count = static_cast<uint32_t>(net.output_n.values().size());
+  header.reverse_count = static_cast<uint32_t>(net.p_to_ts_n.values().size());
+  header.initial_count = static_cast<uint32_t>(initial.size());
+  header.final_count = static_cast<uint32_t>(final.size());
+  header.names_size = static_cast<uint32_t>(names.size());
+
+  Writer writer(path);
+  writer.write(header);
+  writer.write(net.input_n.offsets());
+  writer.write(net.input_n.values());
+  writer.write(net.output_n.offsets());
+  writer.write(net.output_n.values());
+  writer.write(net.p_to_ts_n.offsets());
+  writer.write(net.p_to_ts_n.values());
+  writer.write(Span<int8_t>(net.priority));
+  writer.write(Span<uint32_t>(color_indices));
+  writer.write(Span<MarkingEntry>(initial));
+  writer.write(Span<MarkingEntry>(final));
+  writer.write(Span<uint32_t>(name_offsets));
+  writer.write(Span<char>(names));
+}
+
+std::shared_ptr<const Topology> loadTopology(const std::string &path) {
+  auto topology = std::make_shared<Topology>();
+  auto &net = *topology;
+  size_t size;
+  net.storage = readFile(path, size);
+
+  Reader reader(static_cast<const char *>(net.storage.get()), size);
+  const auto &header = reader.read<Header>(1)[0];
+  if (header.magic != kMagic || header.byte_order != kByteOrder) {
+    throw std::runtime_error("'" + path + "' is not a binary net");
+  } else if (header.version != kVersion ||
+             header.arc_size != sizeof(SmallArc)) {
+    throw std::runtime_error("'" + path + "' has an incompatible version");
+  }
+
+  const size_t transition_count = header.transition_count;
+  const size_t place_count = header.place_count;
+  const auto input_offsets = reader.read<uint32_t>(transition_count + 1);
+  const auto inputs = reader.read<SmallArc>(header.input_count);
+  const auto output_offsets = reader.read<uint32_t>(transition_count + 1);
+  const auto outputs = reader.read<SmallArc>(header.output_count);
+  const auto reverse_offsets = reader.read<uint32_t>(place_count + 1);
+  const auto reverse = reader.read<uint32_t>(header.reverse_count);
+  const auto priority = reader.read<int8_t>(transition_count);
+  const auto color_indices = reader.read<uint32_t>(header.color_count);
+  const auto initial = reader.read<MarkingEntry>(header.initial_count);
+  const auto final = reader.read<MarkingEntry>(header.final_count);
+  const auto name_offsets = reader.read<uint32_t>(
+      transition_count + place_count + header.color_count + 1);
+  const auto names = reader.read<char>(header.names_size);
+
+  const auto is_arc = [&](const SmallArc &arc) {
+    return arc.place < place_count && arc.weight > 0;
+  };
+  validate(input_offsets, inputs, is_arc);
+  validate(output_offsets, outputs, is_arc);
+  validate(reverse_offsets, reverse,
+           [&](uint32_t t) { return t < transition_count; });
+  validate(name_offsets, names, [](char) { return true; });
+  validateReverse(input_offsets, inputs, reverse_offsets, reverse);
+
+  const auto name = [&](size_t i) {
+    return std::string_view(names.begin() + name_offsets[i],
+                            name_offsets[i + 1] - name_offsets[i]);
+  };
+  net.transition.reserve(transition_count);
+  for (size_t i = 0; i < transition_count; i++) {
+    net.transition.push_back(name(i));
+  }
+  net.place.reserve(place_count);
+  for (size_t i = 0; i < place_count; i++) {
+    net.place.push_back(name(transition_count + i));
+  }
+  net.transition_index = createNameIndex(net.transition);
+  net.place_index = createNameIndex(net.place);
+
+  // the colors are identified by their index in the process that saved the
+  // net. The arcs are used in place if this process uses the same indices.
+  std::unordered_map<uint32_t, Token> colors;
+  bool same_colors = true;
+  for (size_t i = 0; i < color_indices.size(); i++) {
+    const auto color = toToken(name(transition_count + place_count + i));
+    colors.emplace(color_indices[i], color);
+    same_colors = same_colors && color.toIndex() == color_indices[i];
+  }
+  const auto to_color = [&](uint32_t index) {
+    const auto color = colors.find(index);
+    if (color == colors.end()) {
+      throw std::runtime_error("binary net is corrupt");
+    }
+    return color->second;
+  };
+  const auto to_csr = [&](Span<uint32_t> offsets, Span<SmallArc> arcs) {
+    if (same_colors) {
+      // the colors of the arcs are used as they are, so they must be known.
+      for (const auto &arc : arcs) {
+        to_color(static_cast<uint32_t>(arc.color.toIndex()));
+      }
+      return Csr<SmallArc>(offsets, arcs);
+    }
+    std::vector<SmallArc> recolored(arcs.begin(), arcs.end());
+    for (auto &arc : recolored) {
+      arc.color = to_color(static_cast<uint32_t>(arc.color.toIndex()));
+    }
+    return Csr<SmallArc>(std::vector<uint32_t>(offsets.begin(), offsets.end()),
+                         std::move(recolored));
+  };
+  net.input_n = to_csr(input_offsets, inputs);
+  net.output_n = to_csr(output_offsets, outputs);
+  net.p_to_ts_n = Csr<uint32_t>(reverse_offsets, reverse);
+  net.priority.assign(priority.begin(), priority.end());
+
+  const auto to_tokens = [&](Span<MarkingEntry> entries) {
+    TokenCounts tokens(place_count);
+    for (const auto &[p, c, n] : entries) {
+      if (p >= place_count) {
+        throw std::runtime_error("binary net is corrupt");
+      }
+      produceTokens(tokens, p, to_color(c), n);
+    }
+    return tokens;
+  };
+  net.initial_tokens = to_tokens(initial);
+  net.final_marking = to_tokens(final);
+  if (final.size() == 0) {
+    net.final_marking.clear();
+  }
+  return topology;
+}
+
+}  // namespace symmetri
@@ -0,0 +1,34 @@
+#include "parser_utilities.h"
+
+#include <stdexcept>
+
+#include "petri.h"
+
+namespace symmetri {
+
+void addArc(Net &net, const std::set<std::string> &places,
+            const std::set<std::string> &transitions,
+            const std::string &arc_id, const std::string &source_id,
+            const std::string &target_id, const char *color,
+            int multiplicity) {
+  const auto arc = arc_id.empty() ? std::string("arc") : "arc " + arc_id;
+  if (multiplicity < 1) {
+    throw std::runtime_error("error: " + arc + " has multiplicity " +
+                             std::to_string(multiplicity) +
+                             ", which is less than 1.");
+  }
+  const auto weight = static_cast<uint32_t>(multiplicity);
+  if (places.find(source_id) != places.end()) {
+    // if the source is a place, tokens are consumed.
+    const auto arc_color = nullptr == color ? Success : toToken(color);
+    net[target_id].first.push_back({source_id, arc_color, weight});
+  } else if (transitions.find(source_id) != transitions.end()) {
+    // if the destination is a place, tokens are produced.
+    net[source_id].second.push_back({target_id, Success, weight});
+  } else {
+    throw std::runtime_error("error: " + arc +
+                             " is not connecting a place to a transition.");
+  }
+}
+
+}  // namespace symmetri
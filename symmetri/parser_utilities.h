@@ -0,0 +1,32 @@
+#pragma once
+
+/** @file parser_utilities.h */
+
+#include <set>
+#include <string>
+
+#include "symmetri/types.h"
+
+namespace symmetri {
+
+/**
+ * @brief Adds an arc of a net file to the net. Whether tokens are consumed or
+ * produced depends on whether the source is a place or a transition. It
+ * throws a std::runtime_error if the arc does not connect a place to a
+ * transition, or if its multiplicity is less than 1.
+ *
+ * @param net
+ * @param places the ids of the places of the file
+ * @param transitions the ids of the transitions of the file
+ * @param arc_id the id of the arc, which may be empty
+ * @param source_id
+ * @param target_id
+ * @param color the color of the arc, nullptr for Success
+ * @param multiplicity the amount of tokens the arc consumes or produces
+ */
+void addArc(Net &net, const std::set<std::string> &places,
+            const std::set<std::string> &transitions,
+            const std::string &arc_id, const std::string &source_id,
+            const std::string &target_id, const char *color, int multiplicity);
+
+}  // namespace symmetri
@@ -1,215 +1,678 @@
 #include "petri.h"
 
+#include <numeric>
+#include <stdexcept>
+#include <unordered_set>
+
 namespace symmetri {
-std::tuple<std::vector<std::string>, std::vector<std::string>,
-           std::vector<Callback>>
+std::tuple<std::vector<std::string_view>, std::vector<std::string_view>>
 convert(const Net &_net) {
-  const auto transition_count = _net.size();
-  std::vector<std::string> transitions;
-  std::vector<std::string> places;
-  std::vector<Callback> store;
-  transitions.reserve(transition_count);
-  store.reserve(transition_count);
+  std::vector<std::string_view> transitions;
+  std::unordered_set<std::string_view> unique_places;
+  transitions.reserve(_net.size());
   for (const auto &[t, io] : _net) {
     transitions.push_back(t);
-    store.push_back(DirectMutation{});
-    for (const auto &p : io.first) {
-      places.push_back(p.first);
+    for (const auto &arc : io.first) {
+      unique_places.insert(arc.place);
+    }
+    for (const auto &arc : io.second) {
+      unique_places.insert(arc.place);
+    }
+  }
+  // the places are sorted once all duplicates are removed.
+  std::vector<std::string_view> places(unique_places.begin(),
+                                       unique_places.end());
+  std::sort(places.begin(), places.end());
+  return {transitions, places};
+}
+
+/**
+ * @brief Copies the names to a single contiguous buffer and makes the views
+ * refer to this buffer instead.
+ *
+ * @param transitions
+ * @param places
+ * @return std::shared_ptr<const std::string> the buffer
+ */
+std::shared_ptr<const std::string> internNames(
+    std::vector<std::string_view> &transitions,
+    std::vector<std::string_view> &places) {
+  auto buffer = std::make_shared<std::string>();
+  for (const auto &names : {&transitions, &places}) {
+    for (const auto &name : *names) {
+      buffer->append(name);
     }
-    for (const auto &p : io.second) {
-      places.push_back(p.first);
+  }
+  size_t offset = 0;
+  for (const auto &names : {&transitions, &places}) {
+    for (auto &name : *names) {
+      name = std::string_view(buffer->data() + offset, name.size());
+      offset += name.size();
     }
-    // sort and remove duplicates.
-    std::sort(places.begin(), places.end());
-    auto last = std::unique(places.begin(), places.end());
-    places.erase(last, places.end());
   }
-  return {transitions, places, store};
+  return buffer;
+}
+
+NameIndex createNameIndex(const std::vector<std::string_view> &names) {
+  NameIndex index;
+  index.reserve(names.size());
+  for (size_t i = 0; i < names.size(); i++) {
+    index.emplace(names[i], static_cast<uint32_t>(i));
+  }
+  return index;
+}
+
+/**
+ * @brief Converts a list of arcs to their compact representation. Arcs that
+ * connect the same colored place are merged into a single arc by adding their
+ * weights. The resulting arcs are ordered by place. It throws a
+ * std::runtime_error if an arc has a weight of 0.
+ *
+ * @param transition the transition of the arcs
+ * @param arcs
+ * @param place_index
+ * @return SmallVectorInput
+ */
+SmallVectorInput toSmallArcs(const std::string &transition,
+                             const std::vector<Arc> &arcs,
+                             const NameIndex &place_index) {
+  SmallVectorInput small_arcs;
+  small_arcs.reserve(arcs.size());
+  for (const auto &[place, color, weight] : arcs) {
+    if (weight == 0) {
+      throw std::runtime_error("error: the arc between place " + place +
+                               " and transition " + transition +
+                               " has weight 0.");
+    }
+    small_arcs.push_back({place_index.at(place), weight, color});
+  }
+  std::sort(small_arcs.begin(), small_arcs.end(),
+            [](const auto &a, const auto &b) {
+              return std::tie(a.place, a.color) < std::tie(b.place, b.color);
+            });
+  // merge the arcs of the same colored place.
+  auto last = small_arcs.begin();
+  for (auto it = small_arcs.begin(); it != small_arcs.end(); it++) {
+    if (it == last) {
+      continue;
+    } else if (it->place == last->place && it->color == last->color) {
+      last->weight += it->weight;
+    } else {
+      *++last = *it;
+    }
+  }
+  if (!small_arcs.empty()) {
+    small_arcs.erase(std::next(last), small_arcs.end());
+  }
+  return small_arcs;
 }
 
 std::tuple<std::vector<SmallVectorInput>, std::vector<SmallVectorInput>>
-populateIoLookups(const Net &_net, const std::vector<Place> &ordered_places) {
+populateIoLookups(const Net &_net, const NameIndex &place_index) {
   std::vector<SmallVectorInput> input_n, output_n;
+  input_n.reserve(_net.size());
+  output_n.reserve(_net.size());
   for (const auto &[t, io] : _net) {
-    SmallVectorInput q_in, q_out;
-    for (const auto &p : io.first) {
-      q_in.push_back(
-          std::make_tuple(toIndex(ordered_places, p.first), p.second));
-    }
-    input_n.push_back(q_in);
-    for (const auto &p : io.second) {
-      q_out.push_back({toIndex(ordered_places, p.first), p.second});
-    }
-    output_n.push_back(q_out);
+    input_n.push_back(toSmallArcs(t, io.first, place_index));
+    output_n.push_back(toSmallArcs(t, io.second, place_index));
   }
   return {input_n, output_n};
 }
 
-std::vector<SmallVector> createReversePlaceToTransitionLookup(
-    size_t place_count, size_t transition_count,
-    const std::vector<SmallVectorInput> &input_transitions) {
-  std::vector<SmallVector> p_to_ts_n;
-  for (size_t p = 0; p < place_count; p++) {
-    SmallVector q;
-    for (size_t c = 0; c < transition_count; c++) {
-      for (const auto &[input_place, input_color] : input_transitions[c]) {
-        if (p == input_place && std::find(q.begin(), q.end(), c) == q.end()) {
-          q.push_back(c);
+Csr<uint32_t> createReversePlaceToTransitionLookup(
+    size_t place_count, const Csr<SmallArc> &input_n) {
+  // the arcs of a transition are ordered by place, so a transition that
+  // consumes multiple colors from the same place is only counted once.
+  const auto for_each_input_place = [&](auto &&f) {
+    for (size_t t = 0; t < input_n.size(); t++) {
+      const auto inputs = input_n[t];
+      for (size_t i = 0; i < inputs.size(); i++) {
+        if (i == 0 || inputs[i - 1].place != inputs[i].place) {
+          f(inputs[i].place, static_cast<uint32_t>(t));
         }
       }
     }
-    p_to_ts_n.push_back(q);
-  }
-  return p_to_ts_n;
+  };
+
+  std::vector<uint32_t> offsets(place_count + 1, 0);
+  for_each_input_place([&](uint32_t p, uint32_t) { offsets[p + 1]++; });
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<uint32_t> values(offsets.back());
+  auto next = offsets;
+  for_each_input_place([&](uint32_t p, uint32_t t) { values[next[p]++] = t; });
+  return Csr<uint32_t>(std::move(offsets), std::move(values));
 }
 
 std::vector<int8_t> createPriorityLookup(
-    const std::vector<Transition> transition, const PriorityTable &_priority) {
+    const std::vector<std::string_view> &transition,
+    const PriorityTable &_priority) {
+  // if a transition occurs multiple times, the first priority is used.
+  std::unordered_map<std::string_view, int8_t> lookup;
+  lookup.reserve(_priority.size());
+  for (const auto &[t, p] : _priority) {
+    lookup.try_emplace(t, p);
+  }
   std::vector<int8_t> priority;
+  priority.reserve(transition.size());
   for (const auto &t : transition) {
-    auto ptr = std::find_if(_priority.begin(), _priority.end(),
-                            [t](const auto &a) { return a.first == t; });
-    priority.push_back(ptr != _priority.end() ? ptr->second : 0);
+    const auto ptr = lookup.find(t);
+    priority.push_back(ptr != lookup.end() ? ptr->second : 0);
   }
   return priority;
 }
 
-Petri::Petri(const Net &_net, const PriorityTable &_priority,
-             const Marking &_initial_tokens, const Marking &_final_marking,
-             const std::string &_case_id,
-             std::shared_ptr<TaskSystem> threadpool)
-    : log({}),
-      state(Scheduled),
-      case_id(_case_id),
-      thread_id_(std::nullopt),
-      reducer_queue(
-          std::make_shared<moodycamel::BlockingConcurrentQueue<Reducer>>(128)),
-      pool(threadpool) {
-  log.reserve(1000);
-  tokens.reserve(100);
-  scheduled_callbacks.reserve(10);
-
-  std::tie(net.transition, net.place, net.store) = convert(_net);
-  std::tie(net.input_n, net.output_n) = populateIoLookups(_net, net.place);
-  net.p_to_ts_n = createReversePlaceToTransitionLookup(
-      net.place.size(), net.transition.size(), net.input_n);
-  net.priority = createPriorityLookup(net.transition, _priority);
+Topology::Topology(const Net &_net, const PriorityTable &_priority,
+                   const Marking &_initial_tokens,
+                   const Marking &_final_marking) {
+  std::tie(transition, place) = convert(_net);
+  storage = internNames(transition, place);
+  transition_index = createNameIndex(transition);
+  place_index = createNameIndex(place);
+  const auto [inputs, outputs] = populateIoLookups(_net, place_index);
+  const auto identity = [](const SmallArc &arc) { return arc; };
+  input_n = Csr<SmallArc>::compress(inputs, identity);
+  output_n = Csr<SmallArc>::compress(outputs, identity);
+  p_to_ts_n = createReversePlaceToTransitionLookup(place.size(), input_n);
+  priority = createPriorityLookup(transition, _priority);
   initial_tokens = toTokens(_initial_tokens);
-  tokens = initial_tokens;
   final_marking = toTokens(_final_marking);
+  if (std::all_of(final_marking.cbegin(), final_marking.cend(),
+                  [](const auto &colors) { return colors.empty(); })) {
+    final_marking.clear();
+  }
 }
 
-std::vector<AugmentedToken> Petri::toTokens(
-    const Marking &marking) const noexcept {
-  std::vector<AugmentedToken> tokens;
+TokenCounts Topology::toTokens(const Marking &marking) const noexcept {
+  TokenCounts tokens(place.size());
   for (const auto &[p, c] : marking) {
-    tokens.push_back({toIndex(net.place, p), c});
+    const auto p_idx = toIndex(place_index, p);
+    if (p_idx < place.size()) {
+      produceTokens(tokens, p_idx, c);
+    }
   }
   return tokens;
 }
 
+Petri::Petri(const Net &_net, const PriorityTable &_priority,
+             const Marking &_initial_tokens, const Marking &_final_marking,
+             const std::string &_case_id,
+             std::shared_ptr<TaskSystem> threadpool)
+    : Petri(std::make_shared<const Topology>(_net, _priority, _initial_tokens,
+                                             _final_marking),
+            _case_id, threadpool) {}
+
+Petri::Petri(std::shared_ptr<const Topology> _topology,
+             const std::string &_case_id,
+             std::shared_ptr<TaskSystem> threadpool)
+    : topology(std::move(_topology)),
+      net(*topology),
+      store(net.transition.size(), DirectMutation{}),
+      unsatisfied_inputs(net.transition.size()),
+      enabled_transitions(net.priority),
+      log({}),
+      state(Scheduled),
+      case_id(_case_id),
+      thread_id_(std::nullopt),
+      mailbox(std::make_shared<Mailbox>()),
+      pool(threadpool),
+      share(std::make_shared<Share>()),
+      wait_policy(WaitPolicy::block()) {
+  setTokens(net.initial_tokens);
+}
+
 void Petri::fireSynchronous(const size_t t) {
-  const auto &task = net.store[t];
+  const auto &task = store[t];
   const auto &lookup_t = net.output_n[t];
   const auto now = Clock::now();
   log.push_back({t, Started, now});
   auto result = fire(task);
   log.push_back({t, result, now});
-  tokens.reserve(tokens.size() + lookup_t.size());
-  for (const auto &[p, c] : lookup_t) {
-    tokens.push_back({p, result});
+  for (const auto &[p, w, c] : lookup_t) {
+    produce(p, result, w);
   }
 }
 
 void Petri::fireAsynchronous(const size_t t) {
-  const auto &task = net.store[t];
   scheduled_callbacks.push_back(t);
   log.push_back({t, Scheduled, Clock::now()});
+  dispatch(t);
+}
+
+/**
+ * @brief The message of a task that was revoked before it started.
+ *
+ * @param t the index of the transition
+ * @param run the key of the deadline of the run
+ * @return Reducer
+ */
+Reducer revocation(size_t t, uint64_t run) {
+  return [t, run](Petri &model) { model.revoke(t, run); };
+}
 
-  pool->push([=] {
-    reducer_queue->enqueue(scheduleCallback(t, task, reducer_queue));
+void Petri::dispatch(const size_t t) {
+  const auto &task = store[t];
+  auto claim = startDeadline(t);
+  const auto generation = mailbox->generation();
+  if (isDeferred(task)) {
+    // the task only starts the Callback, which completes later.
+    auto work = [t, claim = std::move(claim), generation, task,
+                 mailbox = mailbox] {
+      if (claim && claim->is_claimed.exchange(true)) {
+        return;  // the run timed out before it started.
+      }
+      const auto run = claim ? claim->key : 0;
+      if (mailbox->generation() != generation) {
+        mailbox->send(revocation(t, run));
+        return;
+      }
+      const auto start = Clock::now();
+      auto complete = [t, run, start, mailbox](Token result) {
+        mailbox->send(Completion{t, result, start, Clock::now(), run});
+      };
+      static_assert(sizeof(complete) <= Completer::capacity,
+                    "completing a transition should not allocate");
+      fire(task, std::move(complete));
+    };
+    static_assert(sizeof(work) <= TaskSystem::Task::capacity,
+                  "firing a transition should not allocate");
+    pending_tasks.emplace_back(std::move(work));
+  } else {
+    auto work = [t, claim = std::move(claim), generation, task,
+                 mailbox = mailbox] {
+      if (claim && claim->is_claimed.exchange(true)) {
+        return;  // the run timed out before it started.
+      }
+      const auto run = claim ? claim->key : 0;
+      if (mailbox->generation() != generation) {
+        mailbox->send(revocation(t, run));
+        return;
+      }
+      auto completion = runCallback(t, task);
+      completion.run = run;
+      mailbox->send(completion);
+    };
+    static_assert(sizeof(work) <= TaskSystem::Task::capacity,
+                  "firing a transition should not allocate");
+    pending_tasks.emplace_back(std::move(work));
+  }
+  pending_priorities.push_back(net.priority[t]);
+}
+
+void Petri::fireDelayed(const size_t t, Clock::duration delay) {
+  const auto now = Clock::now();
+  scheduled_callbacks.push_back(t);
+  log.push_back({t, Scheduled, now});
+  addDelay(t, now + delay);
+}
+
+void Petri::addDelay(const size_t t, Clock::time_point deadline) {
+  pending_delays.emplace(next_timer_key, Delay{t, deadline});
+  addTimer(deadline, next_timer_key++);
+}
+
+void Petri::addTimer(Clock::time_point deadline, uint64_t key) {
+  if (!timers) {
+    timers = std::make_unique<TimerWheel<uint64_t>>(kTimerResolution,
+                                                     Clock::now());
+  }
+  timers->schedule(deadline, key);
+}
+
+std::shared_ptr<Petri::RunClaim> Petri::startDeadline(const size_t t) {
+  if (deadlines.empty() || deadlines[t].duration <= Clock::duration(0)) {
+    return nullptr;
+  }
+  const auto deadline = Clock::now() + deadlines[t].duration;
+  auto claim = std::make_shared<RunClaim>(next_timer_key);
+  timed_runs.emplace(next_timer_key, TimedRun{t, deadline, claim});
+  addTimer(deadline, next_timer_key++);
+  return claim;
+}
+
+void Petri::timeOut(uint64_t key) {
+  const auto run = timed_runs.find(key);
+  const auto t = run->second.transition;
+  const bool is_started = run->second.claim->is_claimed.exchange(true);
+  timed_runs.erase(run);
+  // once the case stopped, stop logged the run as canceled already and the
+  // deadline only bounds the wait for its completion.
+  if (isActive()) {
+    const auto &timeout = deadlines[t].timeout;
+    if (is_started && std::count(scheduled_callbacks.begin(),
+                                 scheduled_callbacks.end(), t) == 1) {
+      cancel(store[t]);
+    }
+    log.push_back({t, timeout, Clock::now()});
+    for (const auto &[p, w, c] : net.output_n[t]) {
+      produce(p, timeout, w);
+    }
+  }
+  scheduled_callbacks.erase(
+      std::find(scheduled_callbacks.begin(), scheduled_callbacks.end(), t));
+}
+
+size_t Petri::expireTimers(Clock::time_point now) {
+  if (!timers) {
+    return 0;
+  }
+  // the timers of delays that were paused are no longer pending, and ignored.
+  // The timers of deadlines that were paused and resumed are superseded by a
+  // later timer, and ignored too.
+  const auto expired = timers->expire(now, [this, now](uint64_t key) {
+    const auto delay = pending_delays.find(key);
+    const auto run = timed_runs.find(key);
+    if (delay != pending_delays.end()) {
+      const auto t = delay->second.transition;
+      pending_delays.erase(delay);
+      if (isSynchronous(store[t])) {
+        const auto it = std::find(scheduled_callbacks.begin(),
+                                  scheduled_callbacks.end(), t);
+        std::swap(*it, scheduled_callbacks.back());
+        scheduled_callbacks.pop_back();
+        fireSynchronous(t);
+      } else {
+        dispatch(t);
+      }
+    } else if (run != timed_runs.end() && !paused_at &&
+               run->second.deadline <= now) {
+      timeOut(key);
+    }
   });
+  pushPendingTasks();
+  return expired;
 }
 
-void deductMarking(std::vector<AugmentedToken> &tokens,
-                   const SmallVectorInput &inputs) {
-  for (const auto &place : inputs) {
-    // erase one by one. using std::remove_if would remove all tokens at
-    // a particular place.
-    tokens.erase(std::find(tokens.begin(), tokens.end(), place));
+void Petri::pauseTimers(Clock::time_point now) {
+  for (const auto &[key, delay] : pending_delays) {
+    paused_delays.push_back({delay.transition, delay.deadline - now});
+  }
+  pending_delays.clear();
+  if (!paused_at) {
+    paused_at = now;
+  }
+}
+
+void Petri::resumeTimers(Clock::time_point now) {
+  for (const auto &[t, remaining] : paused_delays) {
+    addDelay(t, now + remaining);
+  }
+  paused_delays.clear();
+  if (paused_at) {
+    for (auto &[key, run] : timed_runs) {
+      run.deadline += now - *paused_at;
+      addTimer(run.deadline, key);
+    }
+    paused_at.reset();
+  }
+}
+
+std::optional<Clock::time_point> Petri::nextDeadline() const {
+  const bool is_pending =
+      !pending_delays.empty() || (!timed_runs.empty() && !paused_at);
+  return is_pending ? timers->nextDeadline() : std::nullopt;
+}
+
+std::int64_t Petri::timeout(Clock::time_point now) const {
+  const auto deadline = nextDeadline();
+  if (!deadline) {
+    return -1;
+  }
+  const auto remaining =
+      std::chrono::ceil<std::chrono::microseconds>(*deadline - now);
+  return std::max<std::int64_t>(remaining.count(), 0);
+}
+
+void Petri::pushPendingTasks() {
+  // transitions are fired in order of priority, so tasks of the same priority
+  // are mostly adjacent and pushed as one batch.
+  for (size_t begin = 0, end = 0; begin < pending_tasks.size(); begin = end) {
+    const auto priority = pending_priorities[begin];
+    while (end < pending_tasks.size() && pending_priorities[end] == priority) {
+      end++;
+    }
+    if (end - begin == 1) {
+      pool->push(std::move(pending_tasks[begin]), priority, share);
+    } else {
+      pool->pushBulk(&pending_tasks[begin], end - begin, priority, share);
+    }
+  }
+  pending_tasks.clear();
+  pending_priorities.clear();
+}
+
+void deductMarking(TokenCounts &tokens, Span<SmallArc> inputs) {
+  for (const auto &[p, w, c] : inputs) {
+    consumeTokens(tokens, p, c, w);
+  }
+}
+
+void Petri::setTokens(const TokenCounts &marking) {
+  tokens = marking;
+  unmatched_goals = 0;
+  for (size_t p = 0; p < net.final_marking.size(); p++) {
+    for (const auto &[c, n] : net.final_marking[p]) {
+      unmatched_goals += countTokens(tokens, p, c) != n ? 1 : 0;
+    }
+  }
+  enabled_transitions.clear();
+  for (size_t t = 0; t < net.transition.size(); t++) {
+    const auto &inputs = net.input_n[t];
+    // a transition without inputs can never be enabled by tokens.
+    size_t unsatisfied = inputs.empty() ? 1 : 0;
+    for (const auto &[p, w, c] : inputs) {
+      unsatisfied += countTokens(tokens, p, c) < w ? 1 : 0;
+    }
+    unsatisfied_inputs[t] = unsatisfied;
+    if (unsatisfied == 0) {
+      enabled_transitions.insert(t);
+    }
+  }
+}
+
+void Petri::updateEnabled(size_t place, const Token &color, size_t before,
+                          size_t after) {
+  for (const auto t : net.p_to_ts_n[place]) {
+    const auto &inputs = net.input_n[t];
+    const auto arc =
+        std::find_if(inputs.begin(), inputs.end(), [&](const auto &arc) {
+          return arc.place == place && arc.color == color;
+        });
+    if (arc == inputs.end()) {
+      continue;
+    }
+    const bool was_satisfied = before >= arc->weight;
+    const bool is_satisfied = after >= arc->weight;
+    if (was_satisfied == is_satisfied) {
+      continue;
+    } else if (is_satisfied && --unsatisfied_inputs[t] == 0) {
+      enabled_transitions.insert(t);
+    } else if (!is_satisfied && unsatisfied_inputs[t]++ == 0) {
+      enabled_transitions.erase(t);
+    }
+  }
+}
+
+void Petri::updateGoal(size_t place, const Token &color, size_t before,
+                       size_t after) {
+  if (net.final_marking.empty()) {
+    return;
+  }
+  for (const auto &[c, n] : net.final_marking[place]) {
+    if (c == color) {
+      const bool was_matched = before == n;
+      const bool is_matched = after == n;
+      if (was_matched != is_matched) {
+        is_matched ? unmatched_goals-- : unmatched_goals++;
+      }
+      return;
+    }
+  }
+}
+
+void Petri::produce(size_t place, const Token &color, size_t n) {
+  const auto after = produceTokens(tokens, place, color, n);
+  updateEnabled(place, color, after - n, after);
+  updateGoal(place, color, after - n, after);
+}
+
+void Petri::consume(size_t t) {
+  for (const auto &[p, w, c] : net.input_n[t]) {
+    const auto after = consumeTokens(tokens, p, c, w);
+    updateEnabled(p, c, after + w, after);
+    updateGoal(p, c, after + w, after);
   }
 }
 
 void Petri::tryFire(const Transition &t) {
-  auto it = std::find(net.transition.begin(), net.transition.end(), t);
-  const auto t_idx = std::distance(net.transition.begin(), it);
-  if (canFire(net.input_n[t_idx], tokens)) {
-    deductMarking(tokens, net.input_n[t_idx]);
-    isSynchronous(net.store[t_idx]) ? fireSynchronous(t_idx)
-                                    : fireAsynchronous(t_idx);
+  const auto t_idx = toIndex(net.transition_index, t);
+  if (t_idx < net.transition.size() && unsatisfied_inputs[t_idx] == 0) {
+    fireTransition(t_idx);
+    pushPendingTasks();
   }
 }
 
-gch::small_vector<size_t, 32> &&updatePossibleTransitions(
-    gch::small_vector<size_t, 32> &&possible_transitions,
-    const std::vector<SmallVectorInput> &input_n,
-    const std::vector<int8_t> &priority,
-    const std::vector<AugmentedToken> &tokens) {
-  possible_transitions.erase(
-      std::remove_if(
-          possible_transitions.begin(), possible_transitions.end(),
-          [&](auto t_idx) { return !canFire(input_n[t_idx], tokens); }),
-      possible_transitions.end());
+void Petri::complete(const Completion &completion) {
+  const auto &[t, result, start, end, run] = completion;
+  if (run != 0 && timed_runs.erase(run) == 0) {
+    // the run timed out, and the timeout Token was produced instead.
+    return;
+  }
+  log.push_back({t, Started, start});
+  // if it is in the active transition set it means it is finished and we
+  // should process it.
+  const auto it =
+      std::find(scheduled_callbacks.cbegin(), scheduled_callbacks.cend(), t);
+  if (it != scheduled_callbacks.cend()) {
+    for (const auto &[p, w, c] : net.output_n[t]) {
+      produce(p, result, w);
+    }
+    scheduled_callbacks.erase(it);
+  }
+  log.push_back({t, result, end});
+}
 
-  // sort transition list according to priority
-  std::sort(possible_transitions.begin(), possible_transitions.end(),
-            [&](size_t a, size_t b) { return priority[a] > priority[b]; });
+void Petri::revoke(const size_t t, uint64_t run) {
+  if (run != 0 && timed_runs.erase(run) == 0) {
+    // the run timed out, and the timeout Token was produced instead.
+    return;
+  }
+  if (isActive()) {
+    log.push_back({t, Paused, Clock::now()});
+    held_tasks.push_back(t);
+    // the case may have been resumed before the task reported back.
+    if (state == Started) {
+      releaseTasks();
+    }
+  } else {
+    // stop logged the run as canceled already.
+    scheduled_callbacks.erase(
+        std::find(scheduled_callbacks.begin(), scheduled_callbacks.end(), t));
+  }
+}
 
-  return std::move(possible_transitions);
+void Petri::releaseTasks() {
+  for (const auto t : held_tasks) {
+    log.push_back({t, Scheduled, Clock::now()});
+    dispatch(t);
+  }
+  held_tasks.clear();
+  pushPendingTasks();
+}
+
+void Petri::fireTransition(const size_t t) {
+  consume(t);
+  const auto delay = delays.empty() ? Clock::duration(0) : delays[t];
+  if (delay > Clock::duration(0)) {
+    fireDelayed(t, delay);
+  } else if (isSynchronous(store[t])) {
+    fireSynchronous(t);
+  } else {
+    fireAsynchronous(t);
+  }
 }
 
 void Petri::fireTransitions() {
-  // find possibly active transitions && remove inactive transitions
-  auto possible_transition_list_n = updatePossibleTransitions(
-      possibleTransitions(tokens, net.input_n, net.p_to_ts_n), net.input_n,
-      net.priority, tokens);
-
-  // loop
-  while (!possible_transition_list_n.empty()) {
-    const auto t_idx = possible_transition_list_n.front();
-    deductMarking(tokens, net.input_n[t_idx]);
-    if (isSynchronous(net.store[t_idx])) {
-      fireSynchronous(t_idx);
-      // add the output places-connected transitions as new possible
-      // transitions if they are not already in the list.
-      for (const auto &[p, c] : net.output_n[t_idx]) {
-        for (const auto &t : net.p_to_ts_n[p]) {
-          if (std::find(possible_transition_list_n.begin(),
-                        possible_transition_list_n.end(),
-                        t) == possible_transition_list_n.end()) {
-            possible_transition_list_n.push_back(t);
-          }
-        }
-      }
-    } else {
-      fireAsynchronous(t_idx);
+  // the enabled transitions are kept up to date by every marking mutation, so
+  // firing a transition only requires picking the one with the highest
+  // priority.
+  while (!enabled_transitions.empty()) {
+    fireTransition(enabled_transitions.top());
+  }
+  // all asynchronous firings of this pass are dispatched at once.
+  pushPendingTasks();
+}
+
+void Petri::start() {
+  scheduled_callbacks.clear();
+  timers.reset();
+  pending_delays.clear();
+  paused_delays.clear();
+  timed_runs.clear();
+  paused_at.reset();
+  held_tasks.clear();
+  log.reserve(1000);
+  setTokens(net.initial_tokens);
+  state = Started;
+  mailbox->clear();  // get rid of old messages
+  mailbox->send([](Petri &) {});
+}
+
+void Petri::update() {
+  if (goalReached()) {
+    state = Success;
+  }
+
+  if (state == Started) {
+    // we're firing
+    fireTransitions();
+    // if there's nothing to fire; we deadlocked
+    if (goalReached()) {
+      state = Success;
+    } else if (scheduled_callbacks.size() == 0) {
+      state = Deadlocked;
     }
-    possible_transition_list_n =
-        updatePossibleTransitions(std::move(possible_transition_list_n),
-                                  net.input_n, net.priority, tokens);
+  }
+}
+
+void Petri::stop() {
+  if (goalReached()) {
+    state = Success;
+  }
+
+  for (const auto transition_index : scheduled_callbacks) {
+    cancel(store.at(transition_index));
+    log.push_back({transition_index, Canceled, Clock::now()});
   }
 
-  return;
+  // the tasks that did not start yet report back instead of completing.
+  mailbox->revokeTasks();
+  // the deadlines of the Callbacks that do not complete once canceled also
+  // bound the wait for their completion, even if the case was paused.
+  resumeTimers(Clock::now());
+  // the Callbacks of pending delays and of the tasks that were held back
+  // while the case was paused never started, so they do not complete.
+  const auto drop = [this](size_t t) {
+    const auto it =
+        std::find(scheduled_callbacks.begin(), scheduled_callbacks.end(), t);
+    scheduled_callbacks.erase(it);
+  };
+  for (const auto &[key, delay] : pending_delays) {
+    drop(delay.transition);
+  }
+  for (const auto t : held_tasks) {
+    drop(t);
+  }
+  pending_delays.clear();
+  held_tasks.clear();
 }
 
 Marking Petri::getMarking() const {
   Marking marking;
-  marking.reserve(tokens.size());
-  std::transform(tokens.cbegin(), tokens.cend(), std::back_inserter(marking),
-                 [&](auto place_index) -> std::pair<std::string, Token> {
-                   return {net.place[std::get<size_t>(place_index)],
-                           std::get<Token>(place_index)};
-                 });
+  for (size_t p = 0; p < tokens.size(); p++) {
+    for (const auto &[c, n] : tokens[p]) {
+      marking.insert(marking.end(), n, {Place(net.place[p]), c});
+    }
+  }
   return marking;
 }
 
@@ -217,11 +680,12 @@ Eventlog Petri::getLogInternal() const {
   Eventlog eventlog;
   eventlog.reserve(log.size());
   for (const auto &[t_i, result, time] : log) {
-    eventlog.push_back({case_id, net.transition[t_i], result, time});
+    eventlog.push_back(
+        {case_id, Transition(net.transition[t_i]), result, time});
   }
 
   // get event log from parent nets:
-  for (const auto &callback : net.store) {
+  for (const auto &callback : store) {
     Eventlog sub_el = getLog(callback);
     if (!sub_el.empty()) {
       eventlog.insert(eventlog.end(), sub_el.begin(), sub_el.end());
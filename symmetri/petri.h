@@ -2,25 +2,24 @@
 
 /** @file petri.h */
 
+#include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <string_view>
 #include <tuple>
+#include <unordered_map>
 
 #include "externals/blockingconcurrentqueue.h"
 #include "externals/small_vector.hpp"
 #include "symmetri/callback.h"
 #include "symmetri/tasks.h"
 #include "symmetri/types.h"
+#include "timer_wheel.h"
 
 namespace symmetri {
 
-/**
- * @brief AugmentedToken describes a token with a color in a
- * particular place.
- *
- */
-using AugmentedToken = std::tuple<size_t, Token>;
-
 /**
  * @brief a minimal Event representation.
  *
@@ -43,11 +42,173 @@ using SmallLog = std::vector<SmallEvent>;
  */
 using SmallVector = gch::small_vector<size_t, 4>;
 
+/**
+ * @brief SmallArc is the compact representation of an Arc. It uses a 32 bit
+ * index for the place and carries the multiplicity of the arc as a weight, so
+ * that an arc with weight n is a single entry.
+ *
+ */
+struct SmallArc {
+  uint32_t place;   ///< index of the place
+  uint32_t weight;  ///< the amount of tokens that is consumed or produced
+  Token color;      ///< the color of the tokens that are consumed or produced
+};
+
 /**
  * @brief General purpose stack-allocated mini vector for colored markings
  *
  */
-using SmallVectorInput = gch::small_vector<AugmentedToken, 4>;
+using SmallVectorInput = gch::small_vector<SmallArc, 4>;
+
+/**
+ * @brief Span is a non-owning view on a contiguous range of elements.
+ *
+ * @tparam T the element type
+ */
+template <typename T>
+class Span {
+ public:
+  constexpr Span() noexcept : begin_(nullptr), end_(nullptr) {}
+  constexpr Span(const T *begin, const T *end) noexcept
+      : begin_(begin), end_(end) {}
+  /**
+   * @brief Construct a view on a contiguous container, e.g. a vector.
+   *
+   * @param container
+   */
+  template <typename Container,
+            typename = decltype(std::declval<const Container &>().data())>
+  constexpr Span(const Container &container) noexcept
+      : begin_(container.data()), end_(container.data() + container.size()) {}
+
+  constexpr const T *begin() const noexcept { return begin_; }
+  constexpr const T *end() const noexcept { return end_; }
+  constexpr size_t size() const noexcept { return end_ - begin_; }
+  constexpr bool empty() const noexcept { return begin_ == end_; }
+  constexpr const T &operator[](size_t i) const noexcept { return begin_[i]; }
+
+ private:
+  const T *begin_;
+  const T *end_;
+};
+
+/**
+ * @brief Csr is an immutable compressed sparse row representation of a list
+ * of lists. All rows are stored back-to-back in a single contiguous array and
+ * an array of offsets marks where every row starts. Compared to a vector of
+ * (small) vectors this avoids an allocation per row and lets lookups stream
+ * through memory.
+ *
+ * @tparam T the element type
+ */
+template <typename T>
+class Csr {
+ public:
+  /**
+   * @brief Construct an empty Csr without rows.
+   *
+   */
+  Csr() : offsets_storage_({0}), offsets_(offsets_storage_) {}
+
+  /**
+   * @brief Construct a Csr that owns its offsets and values.
+   *
+   * @param offsets row r is [offsets[r], offsets[r+1]), starts with 0
+   * @param values the rows, back-to-back
+   */
+  Csr(std::vector<uint32_t> &&offsets, std::vector<T> &&values) noexcept
+      : offsets_storage_(std::move(offsets)),
+        values_storage_(std::move(values)),
+        offsets_(offsets_storage_),
+        values_(values_storage_) {}
+
+  /**
+   * @brief Construct a Csr that is a view on offsets and values that are
+   * stored elsewhere, e.g. in a memory-mapped file. The memory must outlive
+   * the Csr.
+   *
+   * @param offsets row r is [offsets[r], offsets[r+1]), starts with 0
+   * @param values the rows, back-to-back
+   */
+  Csr(Span<uint32_t> offsets, Span<T> values) noexcept
+      : offsets_(offsets), values_(values) {}
+
+  // moving a vector keeps its buffer, so the views stay valid.
+  Csr(Csr &&) noexcept = default;
+  Csr &operator=(Csr &&) noexcept = default;
+  Csr(Csr const &) = delete;
+  Csr &operator=(Csr const &) = delete;
+
+  /**
+   * @brief Compresses a list of lists. Every element of a row is converted to
+   * T using f.
+   *
+   * @param rows the list of lists
+   * @param f conversion from an element of a row to T
+   * @return Csr<T>
+   */
+  template <typename Rows, typename F>
+  static Csr<T> compress(const Rows &rows, F &&f) {
+    std::vector<uint32_t> offsets = {0};
+    std::vector<T> values;
+    offsets.reserve(rows.size() + 1);
+    for (const auto &row : rows) {
+      for (const auto &element : row) {
+        values.push_back(f(element));
+      }
+      offsets.push_back(static_cast<uint32_t>(values.size()));
+    }
+    return Csr<T>(std::move(offsets), std::move(values));
+  }
+
+  Span<T> operator[](size_t row) const noexcept {
+    return {values_.begin() + offsets_[row],
+            values_.begin() + offsets_[row + 1]};
+  }
+  size_t size() const noexcept { return offsets_.size() - 1; }
+  Span<uint32_t> offsets() const noexcept { return offsets_; }
+  Span<T> values() const noexcept { return values_; }
+
+ private:
+  std::vector<uint32_t> offsets_storage_;  ///< the offsets, if owned
+  std::vector<T> values_storage_;          ///< the values, if owned
+  Span<uint32_t> offsets_;  ///< row r is [offsets_[r], offsets_[r+1])
+  Span<T> values_;          ///< the rows, back-to-back
+};
+
+/**
+ * @brief ColorCount holds the amount of tokens of a single color.
+ *
+ */
+using ColorCount = std::tuple<Token, size_t>;
+
+/**
+ * @brief TokenCounts is the internal representation of a marking. It is indexed
+ * like `place` and for every place it holds the amount of tokens per color.
+ * Places rarely contain more than a few different colors, so the colors of a
+ * place are kept in a stack-allocated mini vector. Colors without tokens are
+ * not stored.
+ *
+ */
+using TokenCounts = std::vector<gch::small_vector<ColorCount, 2>>;
+
+/**
+ * @brief Get the Token for a color name, creating the color if it does not
+ * exist yet. A Token keeps a view on its name, so unlike the Token-constructor
+ * this copies the name and keeps it alive for the lifetime of the program.
+ *
+ * @param name
+ * @return Token
+ */
+Token toToken(std::string_view name);
+
+/**
+ * @brief NameIndex maps the string representation of a place or transition to
+ * its index. The keys refer to the strings in the `place` or `transition`
+ * vector it is created from.
+ *
+ */
+using NameIndex = std::unordered_map<std::string_view, uint32_t>;
 
 /**
  * @brief a small helper function to get the index representation of a place or
@@ -57,21 +218,62 @@ using SmallVectorInput = gch::small_vector<AugmentedToken, 4>;
  * @param s
  * @return size_t
  */
-size_t toIndex(const std::vector<std::string> &m, const std::string &s);
+size_t toIndex(const std::vector<std::string_view> &m, std::string_view s);
+
+/**
+ * @brief Get the index representation of a place or transition through a hash
+ * lookup. If s is unknown, it returns the amount of names in the index.
+ *
+ * @param m
+ * @param s
+ * @return size_t
+ */
+size_t toIndex(const NameIndex &m, std::string_view s);
+
+/**
+ * @brief Creates a NameIndex for a list of names. The strings the names refer
+ * to must outlive the index.
+ *
+ * @param names
+ * @return NameIndex
+ */
+NameIndex createNameIndex(const std::vector<std::string_view> &names);
+
+/**
+ * @brief Counts the amount of tokens of a particular color in a place.
+ *
+ * @param tokens the current token distribution
+ * @param place index of the place
+ * @param color the color of the tokens that are counted
+ * @return size_t
+ */
+size_t countTokens(const TokenCounts &tokens, size_t place, const Token &color);
+
+/**
+ * @brief Adds n tokens of a particular color to a place.
+ *
+ * @param tokens the current token distribution
+ * @param place index of the place
+ * @param color the color of the added tokens
+ * @param n the amount of tokens that is added
+ * @return size_t the amount of tokens of this color in the place afterwards
+ */
+size_t produceTokens(TokenCounts &tokens, size_t place, const Token &color,
+                     size_t n = 1);
 
 /**
- * @brief calculates a list of possible transitions given the current
- * token-distribution. It returns a list of transitions sorted by priority. The
- * first element being the high priority.
+ * @brief Removes n tokens of a particular color from a place. It throws a
+ * std::runtime_error and leaves the place unchanged if the place holds less
+ * than n tokens of this color.
  *
- * @param tokens
- * @param p_to_ts_n
- * @return gch::small_vector<size_t, 32>
+ * @param tokens the current token distribution
+ * @param place index of the place
+ * @param color the color of the removed tokens
+ * @param n the amount of tokens that is removed
+ * @return size_t the amount of tokens of this color in the place afterwards
  */
-gch::small_vector<size_t, 32> possibleTransitions(
-    const std::vector<AugmentedToken> &tokens,
-    const std::vector<SmallVectorInput> &input_n,
-    const std::vector<SmallVector> &p_to_ts_n);
+size_t consumeTokens(TokenCounts &tokens, size_t place, const Token &color,
+                     size_t n = 1);
 
 /**
  * @brief Takes a vector of input places (pre-conditions) and the current token
@@ -83,8 +285,82 @@ gch::small_vector<size_t, 32> possibleTransitions(
  * @return true if the pre-conditions are met
  * @return false otherwise
  */
-bool canFire(const SmallVectorInput &pre,
-             const std::vector<AugmentedToken> &tokens);
+bool canFire(Span<SmallArc> pre, const TokenCounts &tokens);
+
+/**
+ * @brief Checks if the token count of every colored place in the goal marking
+ * is exactly matched by the current token distribution. An empty goal marking
+ * is never reached.
+ *
+ * @param tokens the current token distribution
+ * @param goal_marking the goal marking
+ * @return true if the goal marking is reached
+ * @return false otherwise
+ */
+bool MarkingReached(const TokenCounts &tokens, const TokenCounts &goal_marking);
+
+/**
+ * @brief ReadyQueue holds the enabled transitions, bucketed by priority.
+ * Priorities are fixed per transition, so every distinct priority of the net
+ * gets a bucket and a bitmap keeps track of the non-empty buckets. Inserting,
+ * removing and retrieving the enabled transition with the highest priority are
+ * all constant time operations. All buckets share a single buffer, so the
+ * queue does not allocate after construction.
+ *
+ */
+class ReadyQueue {
+ public:
+  ReadyQueue() = default;
+
+  /**
+   * @brief Construct a new ReadyQueue for a net with the given priorities.
+   *
+   * @param priority the priority of every transition, indexed like
+   * `transition`
+   */
+  explicit ReadyQueue(const std::vector<int8_t> &priority);
+
+  /**
+   * @brief Adds transition t. The transition must not be in the queue yet.
+   *
+   * @param t transition as index in transition vector
+   */
+  void insert(size_t t) noexcept;
+
+  /**
+   * @brief Removes transition t. The transition must be in the queue.
+   *
+   * @param t transition as index in transition vector
+   */
+  void erase(size_t t) noexcept;
+
+  /**
+   * @brief Get an enabled transition with the highest priority. Within the same
+   * priority, the most recently inserted transition is returned first.
+   *
+   * @return size_t transition as index in transition vector
+   */
+  size_t top() const noexcept;
+
+  /**
+   * @brief Removes all transitions.
+   *
+   */
+  void clear() noexcept;
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_t size() const noexcept { return size_; }
+
+ private:
+  std::vector<uint8_t> rank_;  ///< The bucket of every transition
+  std::vector<size_t>
+      position_;  ///< The position of every queued transition in slots_
+  std::vector<size_t> slots_;  ///< The buckets, in order of priority
+  std::vector<size_t> begin_;  ///< The first slot of every bucket
+  std::vector<size_t> count_;  ///< The amount of transitions in every bucket
+  std::array<uint64_t, 4> non_empty_ = {};  ///< A bit per non-empty bucket
+  size_t size_ = 0;                        ///< The total amount of transitions
+};
 
 /**
  * @brief Forward declaration of the Petri-class
@@ -93,34 +369,288 @@ bool canFire(const SmallVectorInput &pre,
 struct Petri;
 
 /**
- * @brief A Reducer updates the Petri-object. Reducers are used to process the
- * post-callback marking mutations.
+ * @brief A Reducer updates the Petri-object. Reducers are used for control
+ * operations that need to run on the thread that fires the Petri, such as
+ * cancel, pause and getMarking.
  */
 using Reducer = std::function<void(Petri &)>;
 
 /**
- * @brief Schedules the callback associated with transition t_idx/transition. It
- * returns a reducer which is to be executed _after_ Callback task completed.
+ * @brief Completion is the fixed-size record that is posted once the Callback
+ * of a transition finished. Applying it to the Petri produces the output
+ * tokens of the transition and logs the start and end of the Callback.
+ *
+ */
+struct Completion {
+  size_t transition;        ///< the index of the transition
+  Token result = Started;   ///< the result of the Callback
+  Clock::time_point start;  ///< the moment the Callback started
+  Clock::time_point end;    ///< the moment the Callback finished
+  uint64_t run = 0;  ///< the key of the deadline of the run, 0 if it has none
+};
+
+/**
+ * @brief Runs the Callback associated with transition t_idx.
  *
  * @param t_idx the index of the transition as used in the Petri-class
- * @param task the Callback to be scheduled
- * @return Reducer
+ * @param task the Callback to be run
+ * @return Completion the record that is to be applied to the Petri
+ */
+Completion runCallback(size_t t_idx, const Callback &task);
+
+/**
+ * @brief Get a 32 bit representation of the id of the calling thread, which is
+ * used to mark a Petri as fired.
+ *
+ * @return unsigned int
+ */
+unsigned int getThreadId();
+
+/**
+ * @brief A MailboxObserver is notified after every message that is sent to the
+ * Mailbox it observes. It is notified on the sending thread, so it should only
+ * do a minimal amount of work.
+ *
+ */
+class MailboxObserver {
+ public:
+  virtual ~MailboxObserver() = default;
+  virtual void notify() = 0;
+};
+
+/**
+ * @brief Mailbox receives the messages for the thread that fires a Petri.
+ * Completions of Callbacks are the bulk of the traffic and are passed as
+ * Completion records through a lock-free queue, so no allocation is needed per
+ * completion. Reducers are passed through a separate queue. A single
+ * semaphore counts the messages in both queues, so the receiving thread can
+ * block on either.
+ *
  */
-Reducer scheduleCallback(
-    size_t t_idx, const Callback &task,
-    const std::shared_ptr<moodycamel::BlockingConcurrentQueue<Reducer>>
-        &reducer_queue);
+class Mailbox {
+ public:
+  /**
+   * @brief Post a completion record. It is thread-safe.
+   *
+   * @param completion
+   */
+  void send(const Completion &completion);
+
+  /**
+   * @brief Post a reducer. It is thread-safe.
+   *
+   * @param reducer
+   */
+  void send(Reducer &&reducer);
+
+  /**
+   * @brief Waits until there is at least one message or the timeout expired;
+   * it waits according to the WaitPolicy of the model. Then it handles up to
+   * max messages that are available; the completions are dequeued in bulk and
+   * applied before the reducers are run. Only the thread that fires the Petri
+   * may receive.
+   *
+   * @param model the Petri the messages are applied to
+   * @param timeout_usecs the timeout in microseconds, negative waits forever
+   * @param max the maximum amount of messages to handle
+   * @return size_t the amount of handled messages, 0 if it timed out
+   */
+  size_t receive(Petri &model, std::int64_t timeout_usecs,
+                 size_t max = kMaxMessages);
+
+  /**
+   * @brief Discards all messages that are available.
+   *
+   */
+  void clear();
+
+  /**
+   * @brief Sets the observer that is notified after every sent message. A
+   * nullptr removes the observer. It is thread-safe, but a sender that raced
+   * with replacing the observer may still notify the previous one.
+   *
+   * @param observer
+   */
+  void observe(std::shared_ptr<MailboxObserver> observer);
+
+  /**
+   * @brief Revokes the tasks that were dispatched so far: a task that did not
+   * start yet does not run its Callback, but reports that it was revoked. It
+   * is thread-safe.
+   *
+   */
+  void revokeTasks() noexcept {
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  /**
+   * @brief The generation of the tasks that are dispatched now. A task is
+   * revoked once the generation changed.
+   *
+   * @return uint32_t
+   */
+  uint32_t generation() const noexcept {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+ private:
+  /**
+   * @brief Notifies the observer, if there is one.
+   *
+   */
+  void notify() {
+    // the flag saves the relatively expensive atomic load of the observer for
+    // Mailboxes that are not observed, which is the common case.
+    if (is_observed_.load(std::memory_order_acquire)) {
+      if (const auto observer = std::atomic_load(&observer_)) {
+        observer->notify();
+      }
+    }
+  }
+
+  /**
+   * @brief Acquires between 1 and max messages, polling as long as the
+   * WaitPolicy allows before blocking.
+   *
+   * @return std::ptrdiff_t the amount of acquired messages, 0 on a timeout
+   */
+  std::ptrdiff_t wait(std::ptrdiff_t max, std::int64_t timeout_usecs,
+                      const WaitPolicy &wait_policy);
+
+  static constexpr size_t kMaxMessages = 1 << 20;
+  moodycamel::ConcurrentQueue<Completion> completions_;
+  moodycamel::ConcurrentQueue<Reducer> reducers_;
+  moodycamel::LightweightSemaphore messages_{
+      0, 0};  ///< spinning is done according to the WaitPolicy of the Petri
+  std::atomic<bool> is_observed_{false};
+  std::shared_ptr<MailboxObserver> observer_;
+  std::atomic<uint32_t> generation_{0};
+};
 
 /**
- * @brief deducts the set input from the current token distribution
+ * @brief deducts the set input from the current token distribution. It throws
+ * a std::runtime_error if an input place holds too few tokens; the inputs
+ * before that place are deducted already.
  *
  * @param inputs a vector representing the tokens to be removed
  */
-void deductMarking(std::vector<AugmentedToken> &tokens,
-                   const SmallVectorInput &inputs);
+void deductMarking(TokenCounts &tokens, Span<SmallArc> inputs);
+
+/**
+ * @brief Topology is the immutable part of a Petri net: the data-oriented
+ * description of the places, transitions and arcs, and the initial and final
+ * marking. It is created once and shared by every Petri that runs the same
+ * model, so creating a new case does not repeat the conversion work.
+ *
+ */
+struct Topology {
+  /**
+   * @brief Construct a new Topology from a multiset description of a Petri
+   * net, optional priorities and an initial and final marking. A lot of
+   * conversion work is done in the constructor, so you should avoid creating
+   * Topologies during the run-time of a Petri application. It throws a
+   * std::runtime_error if an arc has a weight of 0.
+   *
+   * @param _net
+   * @param _priority
+   * @param _initial_tokens
+   * @param _final_marking
+   */
+  explicit Topology(const Net &_net, const PriorityTable &_priority,
+                    const Marking &_initial_tokens,
+                    const Marking &_final_marking);
+
+  /**
+   * @brief Construct an empty Topology. It is used to restore a Topology from
+   * its binary representation, see loadTopology.
+   *
+   */
+  Topology() = default;
+  ~Topology() noexcept = default;
+  Topology(Topology const &) = delete;
+  Topology(Topology &&) noexcept = delete;
+  Topology &operator=(Topology const &) = delete;
+  Topology &operator=(Topology &&) noexcept = delete;
+
+  /**
+   * @brief converts a marking to token counts; e.g. {{"A", Success}, {"A",
+   * Success}} becomes a count of 2 Success-tokens for the index of place "A".
+   * Tokens in places that are not part of the net are ignored.
+   *
+   * @param marking
+   * @return TokenCounts
+   */
+  TokenCounts toTokens(const Marking &marking) const noexcept;
+
+  /**
+   * @brief Keeps the memory alive that the views of this Topology refer to;
+   * e.g. the names of the places and transitions or a memory-mapped file.
+   *
+   */
+  std::shared_ptr<const void> storage;
+
+  /**
+   * @brief (ordered) list of string representation of transitions
+   *
+   */
+  std::vector<std::string_view> transition;
+
+  /**
+   * @brief (ordered) list of string representation of places
+   *
+   */
+  std::vector<std::string_view> place;
+
+  /**
+   * @brief hash lookup from the string representation of a transition to its
+   * index.
+   *
+   */
+  NameIndex transition_index;
+
+  /**
+   * @brief hash lookup from the string representation of a place to its
+   * index.
+   *
+   */
+  NameIndex place_index;
+
+  /**
+   * @brief list of list of inputs to transitions. The rows are indexed like
+   * `transition`.
+   *
+   */
+  Csr<SmallArc> input_n;
+
+  /**
+   * @brief list of list of outputs of transitions. The rows are indexed like
+   * `transition`.
+   *
+   */
+  Csr<SmallArc> output_n;
+
+  /**
+   * @brief list of list of transitions that have places as inputs. The rows
+   * are indexed like `place`
+   *
+   */
+  Csr<uint32_t> p_to_ts_n;
+
+  /**
+   * @brief This vector holds priorities for all transitions. This vector is
+   * index like `transition`.
+   *
+   */
+  std::vector<int8_t> priority;
+
+  TokenCounts initial_tokens;  ///< The initial marking
+  TokenCounts final_marking;   ///< The final marking, it holds the target
+                               ///< token count per colored place. It is empty
+                               ///< if there is no final marking.
+};
 
 /**
- * @brief Petri is a data structure that encodes the Petri net and holds
+ * @brief Petri holds the run-time state of a single case of a Topology and
  * pointers to the thread-pool and the reducer-queue. It is optimized for
  * calculating the active transition set and dispatching a Callback to the
  * TaskSystem.
@@ -130,8 +660,8 @@ struct Petri {
   /**
    * @brief Construct a new Petri from a multiset description of a Petri
    * net, a lookup table for the transitions, optional priorities and an initial
-   * marking. A lot of conversion work is done in the constructor, so you should
-   * avoid creating Models during the run-time of a Petri application.
+   * marking. This creates a Topology that is not shared with other Petri
+   * objects.
    *
    * @param _net
    * @param _priority
@@ -144,6 +674,18 @@ struct Petri {
                  const Marking &_initial_tokens, const Marking &_final_marking,
                  const std::string &_case_id,
                  std::shared_ptr<TaskSystem> threadpool);
+
+  /**
+   * @brief Construct a new Petri for a shared Topology. Only the run-time
+   * state is allocated, so this is cheap compared to creating the Topology.
+   *
+   * @param _topology
+   * @param _case_id
+   * @param threadpool
+   */
+  explicit Petri(std::shared_ptr<const Topology> _topology,
+                 const std::string &_case_id,
+                 std::shared_ptr<TaskSystem> threadpool);
   ~Petri() noexcept = default;
   Petri(Petri const &) = delete;
   Petri(Petri &&) noexcept = delete;
@@ -151,13 +693,44 @@ struct Petri {
   Petri &operator=(Petri &&) noexcept = delete;
 
   /**
-   * @brief outputs the marking as a vector of tokens; e.g. [1 1 1 0 5] means 3
-   * tokens in place 1, 1 token in place 0 and 1 token in place 5.
+   * @brief Replaces the current marking and recalculates which transitions
+   * are enabled. The marking should not be assigned to `tokens` directly, as
+   * that bypasses the bookkeeping of the enabled transitions.
    *
-   * @param marking
-   * @return std::vector<size_t>
+   * @param marking the new token distribution
+   */
+  void setTokens(const TokenCounts &marking);
+
+  /**
+   * @brief Adds n tokens to a place and updates the enabled transitions that
+   * have this place as input.
+   *
+   * @param place index of the place
+   * @param color the color of the tokens
+   * @param n the amount of tokens
+   */
+  void produce(size_t place, const Token &color, size_t n = 1);
+
+  /**
+   * @brief Removes the input tokens of transition t from the marking and
+   * updates the enabled transitions that share these places as input.
+   *
+   * @param t transition as index in transition vector
+   */
+  void consume(size_t t);
+
+  /**
+   * @brief Checks if the goal marking is reached. The goal is tracked
+   * incrementally while tokens are produced and consumed, so this is a
+   * constant time check. An empty goal marking is never reached.
+   *
+   * @return true if the token count of every colored place in the goal
+   * marking is exactly matched
+   * @return false otherwise
    */
-  std::vector<AugmentedToken> toTokens(const Marking &marking) const noexcept;
+  bool goalReached() const noexcept {
+    return unmatched_goals == 0 && !net.final_marking.empty();
+  }
 
   /**
    * @brief Get the current marking. It is represented by a vector of places:
@@ -179,11 +752,49 @@ struct Petri {
 
   /**
    * @brief Try to fire a single transition. Does nothing if t is not active.
+   * The Callback of a delayed transition starts once its delay expired, like
+   * when the transition is fired by the net.
    *
    * @param t string representation of the transition that is tried to fire.
    */
   void tryFire(const Transition &t);
 
+  /**
+   * @brief Applies a completion record: the output tokens of the transition
+   * are produced if the transition is still scheduled, and the start and
+   * result of the Callback are logged.
+   *
+   * @param completion
+   */
+  void complete(const Completion &completion);
+
+  /**
+   * @brief Handles a task that was revoked before it started. While the case
+   * is active the task is held back, logged as Paused, and dispatched again
+   * once the case is started; otherwise the run is dropped, as stop logged it
+   * as Canceled already.
+   *
+   * @param t transition as index in transition vector
+   * @param run the key of the deadline of the run, 0 if it has none
+   */
+  void revoke(const size_t t, uint64_t run);
+
+  /**
+   * @brief Dispatches the tasks that were held back while the case was paused.
+   *
+   */
+  void releaseTasks();
+
+  /**
+   * @brief Consumes the input tokens of the enabled transition t and fires
+   * it: after its delay, immediately if its Callback is synchronous, and on
+   * the threadpool otherwise. Asynchronous Callbacks are only queued, until
+   * pushPendingTasks.
+   *
+   * @param t transition as index in transition vector
+   */
+  void fireTransition(const size_t t);
+
   /**
    * @brief Fires all active transitions until it there are none left.
    * Associated asynchronous Callbacks are scheduled and synchronous Callback
@@ -192,82 +803,277 @@ struct Petri {
    */
   void fireTransitions();
 
-  struct {
-    /**
-     * @brief (ordered) list of string representation of transitions
-     *
-     */
-    std::vector<std::string> transition;
-
-    /**
-     * @brief (ordered) list of string representation of places
-     *
-     */
-    std::vector<std::string> place;
-
-    /**
-     * @brief list of list of inputs to transitions. This vector is indexed like
-     * `transition`.
-     *
-     */
-    std::vector<SmallVectorInput> input_n;
-
-    /**
-     * @brief list of list of outputs of transitions. This vector is indexed
-     * like `transition`.
-     *
-     */
-    std::vector<SmallVectorInput> output_n;
-
-    /**
-     * @brief list of list of transitions that have places as inputs. This
-     * vector is index like `place`
-     *
-     */
-    std::vector<SmallVector> p_to_ts_n;
-
-    /**
-     * @brief This vector holds priorities for all transitions. This vector is
-     * index like `transition`.
-     *
-     */
-    std::vector<int8_t> priority;
-
-    /**
-     * @brief This is the same 'lookup table', only index using  `transition` so
-     * it is compatible with index lookup.
-     *
-     */
-    std::vector<Callback> store;
-
-    void registerCallback(const std::string &t,
-                          const Callback &callback) noexcept {
-      if (std::find(transition.begin(), transition.end(), t) !=
-          transition.end()) {
-        store[toIndex(transition, t)] = callback;
-      }
+  /**
+   * @brief Resets the case to its initial marking, discards old messages and
+   * starts it by sending a message that triggers the first firing pass.
+   *
+   */
+  void start();
+
+  /**
+   * @brief Updates the case after messages were received: the active
+   * transitions are fired and it is checked whether the goal is reached or the
+   * net deadlocked.
+   *
+   */
+  void update();
+
+  /**
+   * @brief Cancels the Callbacks that are still scheduled once the case is no
+   * longer active. Their completions still have to be received before the
+   * case is finished.
+   *
+   */
+  void stop();
+
+  /**
+   * @brief Starts the Callbacks of which the delay expired and times out the
+   * runs of which the deadline expired.
+   *
+   * @param now
+   * @return size_t the amount of expired timers
+   */
+  size_t expireTimers(Clock::time_point now);
+
+  /**
+   * @brief Freezes the pending delays and deadlines, so they keep the time
+   * that remained until resumeTimers is called.
+   *
+   * @param now
+   */
+  void pauseTimers(Clock::time_point now);
+
+  /**
+   * @brief Continues the delays and deadlines that were frozen by
+   * pauseTimers.
+   *
+   * @param now
+   */
+  void resumeTimers(Clock::time_point now);
+
+  /**
+   * @brief The time at which expireTimers should be called next.
+   *
+   * @return std::optional<Clock::time_point> nullopt if no timer is pending
+   */
+  std::optional<Clock::time_point> nextDeadline() const;
+
+  /**
+   * @brief The time until expireTimers should be called, as a timeout for
+   * Mailbox::receive.
+   *
+   * @param now
+   * @return std::int64_t in microseconds, negative if no timer is pending
+   */
+  std::int64_t timeout(Clock::time_point now) const;
+
+  /**
+   * @brief Checks if the case is still firing; a paused case is active too.
+   *
+   * @return true if the state is Started or Paused
+   * @return false otherwise
+   */
+  bool isActive() const noexcept {
+    return state == Started || state == Paused;
+  }
+
+  /**
+   * @brief The default transition payload (DirectMutation) is overloaded by
+   * the Callback supplied for a specific transition. Does nothing if t is not
+   * a transition of the net.
+   *
+   * @param t the name of transition
+   * @param callback the callback
+   */
+  void registerCallback(const std::string &t,
+                        const Callback &callback) noexcept {
+    const auto t_idx = toIndex(net.transition_index, t);
+    if (t_idx < store.size()) {
+      store[t_idx] = callback;
+    }
+  }
+
+  /**
+   * @brief Sets the delay between firing transition t, which consumes its
+   * input tokens, and starting its Callback. Does nothing if t is not a
+   * transition of the net.
+   *
+   * @param t the name of transition
+   * @param delay
+   */
+  void setDelay(const std::string &t, Clock::duration delay) noexcept {
+    const auto t_idx = toIndex(net.transition_index, t);
+    if (t_idx < store.size()) {
+      delays.resize(store.size(), Clock::duration(0));
+      delays[t_idx] = delay;
+    }
+  }
+
+  /**
+   * @brief Sets the deadline of the asynchronous Callback of transition t.
+   * Does nothing if t is not a transition of the net.
+   *
+   * @param t the name of transition
+   * @param duration
+   * @param timeout the Token that is produced if the deadline expires
+   */
+  void setDeadline(const std::string &t, Clock::duration duration,
+                   const Token &timeout) noexcept {
+    const auto t_idx = toIndex(net.transition_index, t);
+    if (t_idx < store.size()) {
+      deadlines.resize(store.size(), {Clock::duration(0), Failed});
+      deadlines[t_idx] = {duration, timeout};
     }
-  } net;  ///< Is a data-oriented design of a Petri net
+  }
+
+  /**
+   * @brief The time the asynchronous Callback of a transition may take, and
+   * the Token it produces if it takes longer.
+   *
+   */
+  struct Deadline {
+    Clock::duration duration;  ///< zero if the Callback has no deadline
+    Token timeout;
+  };
 
-  std::vector<AugmentedToken> initial_tokens;  ///< The initial marking
-  std::vector<AugmentedToken> tokens;          ///< The current marking
-  std::vector<AugmentedToken> final_marking;   ///< The final marking
-  std::vector<size_t> scheduled_callbacks;     ///< List of active transitions
+  const std::shared_ptr<const Topology>
+      topology;  ///< The net, possibly shared with other cases.
+  const Topology &net;          ///< Is a data-oriented design of a Petri net
+  std::vector<Callback> store;  ///< The Callbacks of this case, indexed like
+                                ///< `net.transition`.
+  std::vector<Clock::duration>
+      delays;  ///< The delays of the transitions of this case, indexed like
+               ///< `net.transition`. It is empty if there are none.
+  std::vector<Deadline>
+      deadlines;  ///< The deadlines of the transitions of this case, indexed
+                  ///< like `net.transition`. It is empty if there are none.
+  TokenCounts tokens;           ///< The current marking
+  size_t unmatched_goals;  ///< The amount of colored places in the final
+                           ///< marking of which the token count does not
+                           ///< match the target.
+  std::vector<size_t> scheduled_callbacks;  ///< List of active transitions
+  std::vector<size_t>
+      unsatisfied_inputs;  ///< For every transition the amount of colored
+                           ///< input places that lack tokens. A transition is
+                           ///< enabled when this drops to zero.
+  ReadyQueue enabled_transitions;  ///< The transitions that are currently
+                                   ///< enabled, ordered by priority
   SmallLog log;         ///< The most up to date event_log
   Token state;          ///< The current state of the Petri
   std::string case_id;  ///< The unique identifier for this Petri-run
   std::atomic<std::optional<unsigned int>>
       thread_id_;  ///< The id of the thread from which the Petri is fired.
 
-  std::shared_ptr<moodycamel::BlockingConcurrentQueue<Reducer>>
-      reducer_queue;  ///< A pointer to the reducer queue. It is a shared
-                      ///< pointer because it needs to be captured by Reducers
-                      ///< which are executed later, guaranteeing the queue is
-                      ///< not destroyed while in use.
+  std::shared_ptr<Mailbox>
+      mailbox;  ///< A pointer to the mailbox. It is a shared pointer because
+                ///< it needs to be captured by tasks which are executed
+                ///< later, guaranteeing the mailbox is not destroyed while in
+                ///< use.
   std::shared_ptr<TaskSystem>
       pool;  ///< A pointer to the threadpool used to defer Callbacks.
+  const std::shared_ptr<Share>
+      share;  ///< The share of the case in the TaskSystem, which tags its
+              ///< tasks for a fair-share scheduler.
+  WaitPolicy wait_policy;  ///< The way the firing thread waits for messages.
+  std::vector<unsigned> fire_cpus;  ///< The CPUs the firing thread is pinned
+                                   ///< to while it fires, if any.
 
  private:
+  std::vector<TaskSystem::Task>
+      pending_tasks;  ///< The tasks of asynchronous firings that are not yet
+                      ///< pushed to the threadpool.
+  std::vector<int8_t> pending_priorities;  ///< The priority of every pending
+                                          ///< task.
+
+  /**
+   * @brief A transition that fired and waits for its delay to expire.
+   *
+   */
+  struct Delay {
+    size_t transition;
+    Clock::time_point deadline;
+  };
+
+  /**
+   * @brief Is shared by the task of a run that has a deadline and the case.
+   * The task claims the run when it starts and the case claims it when the
+   * deadline expires; only the first claim succeeds, so a run that times out
+   * while it is queued is never started.
+   *
+   */
+  struct RunClaim {
+    explicit RunClaim(uint64_t _key) : key(_key) {}
+    const uint64_t key;  ///< the key of the deadline of the run
+    std::atomic<bool> is_claimed{false};
+  };
+
+  /**
+   * @brief A run of a Callback that has a deadline.
+   *
+   */
+  struct TimedRun {
+    size_t transition;
+    Clock::time_point deadline;
+    std::shared_ptr<RunClaim> claim;
+  };
+
+  std::unique_ptr<TimerWheel<uint64_t>>
+      timers;  ///< The timers of the pending delays and deadlines, identified
+               ///< by their key. It is only created once a timer is pending.
+  std::unordered_map<uint64_t, Delay>
+      pending_delays;  ///< The delays that did not expire, by their key.
+  std::vector<std::pair<size_t, Clock::duration>>
+      paused_delays;  ///< The remaining time of the delays while paused.
+  std::unordered_map<uint64_t, TimedRun>
+      timed_runs;  ///< The runs that did not complete or time out, by the key
+                   ///< of their deadline.
+  std::optional<Clock::time_point>
+      paused_at;  ///< The moment the deadlines were frozen, if they are.
+  uint64_t next_timer_key = 1;  ///< 0 is the key of runs without a deadline.
+  std::vector<size_t> held_tasks;  ///< The transitions of which the task was
+                                   ///< revoked while the case was paused.
+
+  /**
+   * @brief Starts the delay of transition t.
+   *
+   * @param t transition as index in transition vector
+   * @param delay
+   */
+  void fireDelayed(const size_t t, Clock::duration delay);
+
+  /**
+   * @brief Adds a timer for a pending delay.
+   *
+   */
+  void addDelay(const size_t t, Clock::time_point deadline);
+
+  /**
+   * @brief Adds a timer to the wheel, which is created if needed.
+   *
+   */
+  void addTimer(Clock::time_point deadline, uint64_t key);
+
+  /**
+   * @brief Starts the deadline of a run of the Callback of t, if it has one.
+   *
+   * @param t transition as index in transition vector
+   * @return std::shared_ptr<RunClaim> the claim of the run, nullptr if it has
+   * no deadline
+   */
+  std::shared_ptr<RunClaim> startDeadline(const size_t t);
+
+  /**
+   * @brief Produces the timeout Token of the transition of a run of which the
+   * deadline expired. A run that did not start yet is dropped. The Callback of
+   * a run that started is canceled if it is the only run of its transition
+   * that is scheduled, as canceling a Callback applies to all its runs. The
+   * completion of the run is ignored once it arrives. Once the case stopped,
+   * the run is only no longer waited for.
+   *
+   * @param key the key of the deadline of the run
+   */
+  void timeOut(uint64_t key);
+
   /**
    * @brief Runs the Callback associated with t immediately.
    *
@@ -276,11 +1082,51 @@ struct Petri {
   void fireSynchronous(const size_t t);
 
   /**
-   * @brief Schedules the Callback associated with t on the threadpool
+   * @brief Schedules the Callback associated with t on the threadpool. The
+   * task is pushed by pushPendingTasks.
    *
    * @param t transition as index in transition vector
    */
   void fireAsynchronous(const size_t t);
+
+  /**
+   * @brief Creates the task that runs the Callback associated with t, which
+   * is pushed by pushPendingTasks.
+   *
+   * @param t transition as index in transition vector
+   */
+  void dispatch(const size_t t);
+
+  /**
+   * @brief Pushes the tasks of the asynchronous firings to the threadpool in a
+   * batch per priority; the tasks have the priority of their transition.
+   *
+   */
+  void pushPendingTasks();
+
+  /**
+   * @brief Updates the unsatisfied input count of the transitions that
+   * consume the colored place after its token count changed.
+   *
+   * @param place index of the place
+   * @param color the color of which the token count changed
+   * @param before the token count before the change
+   * @param after the token count after the change
+   */
+  void updateEnabled(size_t place, const Token &color, size_t before,
+                     size_t after);
+
+  /**
+   * @brief Updates the amount of unmatched goals after the token count of a
+   * colored place changed.
+   *
+   * @param place index of the place
+   * @param color the color of which the token count changed
+   * @param before the token count before the change
+   * @param after the token count after the change
+   */
+  void updateGoal(size_t place, const Token &color, size_t before,
+                  size_t after);
 };
 
 }  // namespace symmetri
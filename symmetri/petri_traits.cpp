@@ -3,7 +3,6 @@
 
 #include "petri.h"
 #include "symmetri/symmetri.h"
-#include "symmetri/utilities.hpp"
 namespace symmetri {
 
 /**
@@ -24,81 +23,57 @@ Token fire(const PetriNet &app) {
   }
   auto &m = *app.impl;
   m.thread_id_.store(getThreadId());
-  m.scheduled_callbacks.clear();
-  m.tokens = m.initial_tokens;
-  m.state = Started;
-  Reducer f;
-  while (m.reducer_queue->try_dequeue(f)) { /* get rid of old reducers  */
-  }
-
-  // start!
-  m.reducer_queue->enqueue([=](Petri &) {});
-  while ((m.state == Started || m.state == Paused) &&
-         m.reducer_queue->wait_dequeue_timed(f, -1)) {
-    do {
-      f(m);
-    } while (m.reducer_queue->try_dequeue(f));
-
-    if (MarkingReached(m.tokens, m.final_marking)) {
-      m.state = Success;
-    }
-
-    if (m.state == Started) {
-      // we're firing
-      m.fireTransitions();
-      // if there's nothing to fire; we deadlocked
-      if (MarkingReached(m.tokens, m.final_marking)) {
-        m.state = Success;
-      } else if (m.scheduled_callbacks.size() == 0) {
-        m.state = Deadlocked;
-      }
-    }
-  }
-
-  if (MarkingReached(m.tokens, m.final_marking)) {
-    m.state = Success;
-  }
-
-  for (const auto transition_index : m.scheduled_callbacks) {
-    cancel(m.net.store.at(transition_index));
-    m.log.push_back({transition_index, Canceled, Clock::now()});
+  // the CPUs are validated by setFireAffinity, so pinning only fails in
+  // exotic setups in which the net is simply fired unpinned.
+  const auto previous_cpus =
+      m.fire_cpus.empty() ? std::vector<unsigned>() : availableCpus();
+  setThreadAffinity(m.fire_cpus);
+  m.start();
+  while (m.isActive()) {
+    // without pending delays this blocks until there is a message.
+    m.mailbox->receive(m, m.timeout(Clock::now()));
+    m.expireTimers(Clock::now());
+    m.update();
   }
+  m.stop();
 
+  // blocks until the last completion arrives; a Callback that does not
+  // complete is still bounded by its deadline.
   while (!m.scheduled_callbacks.empty()) {
-    if (m.reducer_queue->wait_dequeue_timed(f, std::chrono::milliseconds(10))) {
-      f(m);
-    }
+    m.mailbox->receive(m, m.timeout(Clock::now()));
+    m.expireTimers(Clock::now());
   }
 
+  setThreadAffinity(previous_cpus);
   m.thread_id_.store(std::nullopt);
 
   return m.state;
 }
 
 void cancel(const PetriNet &app) {
-  app.impl->reducer_queue->enqueue([=](Petri &model) {
-    model.state = Canceled;
-    for (const auto transition_index : model.scheduled_callbacks) {
-      cancel(model.net.store.at(transition_index));
-      model.log.push_back({transition_index, Canceled, Clock::now()});
-    }
-  });
+  // the scheduled Callbacks are canceled by stop, right after this message.
+  app.impl->mailbox->send([](Petri &model) { model.state = Canceled; });
 }
 
 void pause(const PetriNet &app) {
-  app.impl->reducer_queue->enqueue([](Petri &model) {
+  app.impl->mailbox->send([](Petri &model) {
     model.state = Paused;
+    model.pauseTimers(Clock::now());
+    // the tasks that did not start yet are held back until resume.
+    model.mailbox->revokeTasks();
     for (const auto transition_index : model.scheduled_callbacks) {
-      pause(model.net.store.at(transition_index));
+      pause(model.store.at(transition_index));
     }
   });
 }
 
 void resume(const PetriNet &app) {
-  app.impl->reducer_queue->enqueue([](Petri &model) {
+  app.impl->mailbox->send([](Petri &model) {
     model.state = Started;
+    model.resumeTimers(Clock::now());
+    model.releaseTasks();
     for (const auto transition_index : model.scheduled_callbacks) {
-      resume(model.net.store.at(transition_index));
+      resume(model.store.at(transition_index));
     }
   });
 }
@@ -107,7 +82,7 @@ Eventlog getLog(const PetriNet &app) {
   if (app.impl->thread_id_.load()) {
     std::promise<Eventlog> el;
     std::future<Eventlog> el_getter = el.get_future();
-    app.impl->reducer_queue->enqueue(
+    app.impl->mailbox->send(
         [&](Petri &model) { el.set_value(model.getLogInternal()); });
     return el_getter.get();
   } else {
@@ -1,75 +1,265 @@
 
 #include "petri.h"
+
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+
 namespace symmetri {
 
-size_t toIndex(const std::vector<std::string> &m, const std::string &s) {
+size_t toIndex(const std::vector<std::string_view> &m, std::string_view s) {
   auto ptr = std::find(m.begin(), m.end(), s);
   return std::distance(m.begin(), ptr);
 }
 
-bool canFire(const SmallVectorInput &pre,
-             const std::vector<AugmentedToken> &tokens) {
+size_t toIndex(const NameIndex &m, std::string_view s) {
+  const auto ptr = m.find(s);
+  return ptr != m.end() ? ptr->second : m.size();
+}
+
+Token toToken(std::string_view name) {
+  static std::mutex mutex;
+  static std::unordered_set<std::string> names;
+  std::lock_guard<std::mutex> lock(mutex);
+  return Token(names.emplace(name).first->c_str());
+}
+
+size_t countTokens(const TokenCounts &tokens, size_t place,
+                   const Token &color) {
+  const auto &colors = tokens[place];
+  const auto it =
+      std::find_if(colors.cbegin(), colors.cend(), [&](const auto &c_n) {
+        return std::get<Token>(c_n) == color;
+      });
+  return it != colors.cend() ? std::get<size_t>(*it) : 0;
+}
+
+size_t produceTokens(TokenCounts &tokens, size_t place, const Token &color,
+                     size_t n) {
+  auto &colors = tokens[place];
+  const auto it =
+      std::find_if(colors.begin(), colors.end(), [&](const auto &c_n) {
+        return std::get<Token>(c_n) == color;
+      });
+  if (it != colors.end()) {
+    return std::get<size_t>(*it) += n;
+  } else {
+    colors.push_back({color, n});
+    return n;
+  }
+}
+
+size_t consumeTokens(TokenCounts &tokens, size_t place, const Token &color,
+                     size_t n) {
+  auto &colors = tokens[place];
+  const auto it =
+      std::find_if(colors.begin(), colors.end(), [&](const auto &c_n) {
+        return std::get<Token>(c_n) == color;
+      });
+  if (it == colors.end() || std::get<size_t>(*it) < n) {
+    throw std::runtime_error("place " + std::to_string(place) +
+                             " holds less than " + std::to_string(n) + " " +
+                             std::string(color.toString()) + " tokens");
+  }
+  const auto remaining = std::get<size_t>(*it) -= n;
+  // colors without tokens are removed to keep the lookups short.
+  if (remaining == 0) {
+    colors.erase(it);
+  }
+  return remaining;
+}
+
+bool canFire(Span<SmallArc> pre, const TokenCounts &tokens) {
   return pre.size() > 0 &&
-         std::all_of(pre.begin(), pre.end(), [&](const auto &m_p) {
-           size_t actual = std::count(tokens.begin(), tokens.end(), m_p);
-           size_t required = std::count(pre.begin(), pre.end(), m_p);
-           return actual >= required;
+         std::all_of(pre.begin(), pre.end(), [&](const auto &arc) {
+           return countTokens(tokens, arc.place, arc.color) >= arc.weight;
          });
 }
 
-gch::small_vector<size_t, 32> possibleTransitions(
-    const std::vector<AugmentedToken> &tokens,
-    const std::vector<SmallVectorInput> &input_n,
-    const std::vector<SmallVector> &p_to_ts_n) {
-  gch::small_vector<size_t, 32> possible_transition_list_n;
-  for (const AugmentedToken &place : tokens) {
-    // transition index
-    for (size_t t : p_to_ts_n[std::get<size_t>(place)]) {
-      const auto &inputs = input_n[t];
-      // current colored place is an input of t
-      const bool is_input =
-          std::find(inputs.cbegin(), inputs.cend(), place) != inputs.cend();
-      // transition is not already considered:
-      const bool is_unique = std::find(possible_transition_list_n.cbegin(),
-                                       possible_transition_list_n.cend(),
-                                       t) == possible_transition_list_n.cend();
-      if (is_unique && is_input) {
-        possible_transition_list_n.push_back(t);
+bool MarkingReached(const TokenCounts &tokens,
+                    const TokenCounts &goal_marking) {
+  const bool is_empty =
+      std::all_of(goal_marking.cbegin(), goal_marking.cend(),
+                  [](const auto &colors) { return colors.empty(); });
+  if (is_empty) {
+    return false;
+  }
+
+  for (size_t p = 0; p < goal_marking.size(); p++) {
+    for (const auto &[c, n] : goal_marking[p]) {
+      if (countTokens(tokens, p, c) != n) {
+        return false;
       }
     }
   }
+  return true;
+}
 
-  return possible_transition_list_n;
-}
-
-Reducer createReducerForCallback(const size_t t_i, const Token result) {
-  const auto t_end(Clock::now());
-  return [=](Petri &model) {
-    // if it is in the active transition set it means it is finished and we
-    // should process it.
-    const auto it = std::find(model.scheduled_callbacks.cbegin(),
-                              model.scheduled_callbacks.cend(), t_i);
-    if (it != model.scheduled_callbacks.cend()) {
-      const auto &place_list = model.net.output_n[t_i];
-      model.tokens.reserve(model.tokens.size() + place_list.size());
-      for (const auto &[p, c] : place_list) {
-        model.tokens.push_back({p, result});
-      }
-      model.scheduled_callbacks.erase(it);
-    };
-    model.log.push_back({t_i, result, t_end});
-  };
+/**
+ * @brief Get the index of the most significant set bit of a non-zero word.
+ *
+ * @param word
+ * @return size_t
+ */
+size_t highestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(word);
+#else
+  size_t bit = 0;
+  while (word >>= 1) {
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+ReadyQueue::ReadyQueue(const std::vector<int8_t> &priority)
+    : rank_(priority.size()),
+      position_(priority.size()),
+      slots_(priority.size()) {
+  // every distinct priority gets a bucket, ordered from low to high priority.
+  auto ranks = priority;
+  std::sort(ranks.begin(), ranks.end());
+  ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+  begin_.resize(ranks.size(), 0);
+  count_.resize(ranks.size(), 0);
+  for (size_t t = 0; t < priority.size(); t++) {
+    const auto rank =
+        std::lower_bound(ranks.begin(), ranks.end(), priority[t]);
+    rank_[t] = std::distance(ranks.begin(), rank);
+    count_[rank_[t]]++;
+  }
+  // the buckets are consecutive ranges in slots_, as large as the amount of
+  // transitions with that priority.
+  for (size_t r = 1; r < ranks.size(); r++) {
+    begin_[r] = begin_[r - 1] + count_[r - 1];
+  }
+  std::fill(count_.begin(), count_.end(), 0);
 }
 
-Reducer scheduleCallback(
-    size_t t_i, const Callback &task,
-    const std::shared_ptr<moodycamel::BlockingConcurrentQueue<Reducer>>
-        &reducer_queue) {
-  reducer_queue->enqueue([start_time = Clock::now(), t_i](Petri &model) {
-    model.log.push_back({t_i, Started, start_time});
-  });
+void ReadyQueue::insert(size_t t) noexcept {
+  const auto r = rank_[t];
+  position_[t] = begin_[r] + count_[r]++;
+  slots_[position_[t]] = t;
+  non_empty_[r / 64] |= uint64_t(1) << (r % 64);
+  size_++;
+}
+
+void ReadyQueue::erase(size_t t) noexcept {
+  const auto r = rank_[t];
+  // swap the last transition of the bucket into the place of t.
+  const auto last = slots_[begin_[r] + --count_[r]];
+  slots_[position_[t]] = last;
+  position_[last] = position_[t];
+  if (count_[r] == 0) {
+    non_empty_[r / 64] &= ~(uint64_t(1) << (r % 64));
+  }
+  size_--;
+}
+
+size_t ReadyQueue::top() const noexcept {
+  for (size_t w = non_empty_.size(); w-- > 0;) {
+    if (non_empty_[w] != 0) {
+      const auto r = w * 64 + highestBit(non_empty_[w]);
+      return slots_[begin_[r] + count_[r] - 1];
+    }
+  }
+  return slots_.size();
+}
+
+void ReadyQueue::clear() noexcept {
+  std::fill(count_.begin(), count_.end(), 0);
+  non_empty_ = {};
+  size_ = 0;
+}
+
+Completion runCallback(size_t t_idx, const Callback &task) {
+  const auto start = Clock::now();
+  const auto result = fire(task);
+  return {t_idx, result, start, Clock::now()};
+}
+
+void Mailbox::send(const Completion &completion) {
+  completions_.enqueue(completion);
+  messages_.signal();
+  notify();
+}
+
+void Mailbox::send(Reducer &&reducer) {
+  reducers_.enqueue(std::move(reducer));
+  messages_.signal();
+  notify();
+}
+
+size_t Mailbox::receive(Petri &model, std::int64_t timeout_usecs,
+                        size_t max) {
+  // every message is enqueued before it is signaled, so after acquiring n
+  // signals there are at least n messages to dequeue.
+  const auto n = static_cast<size_t>(
+      wait(static_cast<std::ptrdiff_t>(max), timeout_usecs, model.wait_policy));
+  std::array<Completion, 32> completions;
+  Reducer reducer;
+  size_t handled = 0;
+  while (handled < n) {
+    const auto count = completions_.try_dequeue_bulk(
+        completions.begin(), std::min(completions.size(), n - handled));
+    for (size_t i = 0; i < count; i++) {
+      model.complete(completions[i]);
+    }
+    handled += count;
+    if (count == 0 && reducers_.try_dequeue(reducer)) {
+      reducer(model);
+      handled++;
+    }
+  }
+  return n;
+}
+
+std::ptrdiff_t Mailbox::wait(std::ptrdiff_t max, std::int64_t timeout_usecs,
+                            const WaitPolicy &wait_policy) {
+  auto n = messages_.tryWaitMany(max);
+  if (n > 0 || timeout_usecs == 0) {
+    return n;
+  }
+  const auto deadline = Clock::now() + std::chrono::microseconds(timeout_usecs);
+  const auto poll_count = wait_policy.pollCount();
+  for (size_t i = 1; n == 0 && i <= poll_count; i++) {
+    WaitPolicy::relax();
+    n = messages_.tryWaitMany(max);
+    // reading the clock is relatively expensive, so it is not done every poll.
+    if (n == 0 && timeout_usecs > 0 && i % 64 == 0 &&
+        Clock::now() >= deadline) {
+      return 0;
+    }
+  }
+  if (n > 0) {
+    return n;
+  } else if (timeout_usecs < 0) {
+    return messages_.waitMany(max, -1);
+  } else {
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::microseconds>(deadline -
+                                                              Clock::now());
+    return remaining.count() > 0 ? messages_.waitMany(max, remaining.count())
+                                 : 0;
+  }
+}
+
+void Mailbox::clear() {
+  auto n = messages_.tryWaitMany(static_cast<std::ptrdiff_t>(kMaxMessages));
+  Completion completion;
+  Reducer reducer;
+  while (n > 0) {
+    if (completions_.try_dequeue(completion) ||
+        reducers_.try_dequeue(reducer)) {
+      n--;
+    }
+  }
+}
 
-  return createReducerForCallback(t_i, fire(task));
+void Mailbox::observe(std::shared_ptr<MailboxObserver> observer) {
+  is_observed_.store(observer != nullptr, std::memory_order_release);
+  std::atomic_store(&observer_, std::move(observer));
 }
 
 }  // namespace symmetri
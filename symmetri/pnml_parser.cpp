@@ -1,10 +1,14 @@
 #include <map>
+#include <optional>
 #include <stdexcept>
 #include <string>
 
+#include "parser_utilities.h"
+#include "petri.h"
 #include "symmetri/colors.hpp"
 #include "symmetri/parsers.h"
 #include "tinyxml2/tinyxml2.h"
+#include "xml_stream.h"
 using namespace tinyxml2;
 
 namespace symmetri {
@@ -60,34 +64,131 @@ std::tuple<Net, Marking> readPnml(const std::set<std::string> &files) {
                               ->FirstChildElement("text")
                               ->GetText());
 
-      for (int i = 0; i < multiplicity; i++) {
-        if (places.find(source_id) != places.end()) {
-          // if the source is a place, tokens are consumed.
-          const auto arc_color = NULL == color ? Success : Token(color);
-          if (state_net.find(target_id) != state_net.end()) {
-            state_net.find(target_id)->second.first.push_back(
-                {source_id, arc_color});
-          } else {
-            state_net.insert({target_id, {{{source_id, arc_color}}, {}}});
-          }
-        } else if (transitions.find(source_id) != transitions.end()) {
-          // if the destination is a place, tokens are produced.
-          if (state_net.find(source_id) != state_net.end()) {
-            state_net.find(source_id)->second.second.push_back(
-                {target_id, Success});
-          } else {
-            state_net.insert({source_id, {{}, {{target_id, Success}}}});
-          }
-        } else {
-          const auto arc_id = child->Attribute("id");
-          throw std::runtime_error(
-              std::string("error: arc ") + arc_id +
-              std::string("is not connecting a place to a transition."));
-        }
+      const auto arc_id = child->Attribute("id");
+      addArc(state_net, places, transitions, arc_id ? arc_id : "", source_id,
+             target_id, color, multiplicity);
+    }
+  }
+
+  return {state_net, place_initialMarking};
+}
+
+namespace {
+
+/**
+ * @brief An arc that is added to the net once the whole file is read; only
+ * then it is known whether its source is a place or a transition.
+ *
+ */
+struct PendingArc {
+  std::string id;
+  std::string source;
+  std::string target;
+  std::optional<std::string> color;
+  int multiplicity;
+};
+
+/**
+ * @brief Collects the places, transitions and arcs of the first page of a
+ * pnml-file while it is streamed.
+ *
+ */
+class PnmlHandler final : public XmlHandler {
+ public:
+  PnmlHandler(std::set<std::string> &places,
+              std::set<std::string> &transitions, Marking &marking,
+              std::vector<PendingArc> &arcs)
+      : places_(places),
+        transitions_(transitions),
+        marking_(marking),
+        arcs_(arcs) {}
+
+  void startElement(std::string_view name,
+                    const XmlAttributes &attributes) override {
+    path_.emplace_back(name);
+    text_.clear();
+    const auto attribute = [&](std::string_view key) {
+      const auto value = findAttribute(attributes, key);
+      if (value == nullptr) {
+        throw std::runtime_error("error: <" + std::string(name) +
+                                 "> has no attribute " + std::string(key));
       }
+      return *value;
+    };
+    if (at({"place"})) {
+      place_ = attribute("id");
+      initial_marking_ = 0;
+    } else if (at({"transition"})) {
+      transitions_.insert(attribute("id"));
+    } else if (at({"arc"})) {
+      const auto color = findAttribute(attributes, "color");
+      arc_ = {attribute("id"), attribute("source"), attribute("target"),
+              color ? std::optional<std::string>(*color) : std::nullopt, 1};
     }
   }
 
+  void endElement(std::string_view) override {
+    if (at({"place", "initialMarking", "text"})) {
+      initial_marking_ = std::stoi(text_);
+    } else if (at({"place"})) {
+      for (int i = 0; i < initial_marking_; i++) {
+        marking_.push_back({place_, Success});
+      }
+      places_.insert(place_);
+    } else if (at({"arc", "inscription", "text"})) {
+      arc_.multiplicity = std::stoi(text_);
+    } else if (at({"arc"})) {
+      arcs_.push_back(std::move(arc_));
+    }
+    path_.pop_back();
+  }
+
+  void text(std::string_view text) override { text_.append(text); }
+
+ private:
+  /**
+   * @brief Checks if the current element is at path relative to the page.
+   *
+   */
+  bool at(std::initializer_list<std::string_view> path) const {
+    static constexpr std::array<std::string_view, 3> page = {"pnml", "net",
+                                                             "page"};
+    return path_.size() == page.size() + path.size() &&
+           std::equal(page.begin(), page.end(), path_.begin()) &&
+           std::equal(path.begin(), path.end(), path_.begin() + page.size());
+  }
+
+  std::set<std::string> &places_;
+  std::set<std::string> &transitions_;
+  Marking &marking_;
+  std::vector<PendingArc> &arcs_;
+  std::vector<std::string> path_;
+  std::string text_;
+  std::string place_;
+  int initial_marking_ = 0;
+  PendingArc arc_;
+};
+
+}  // namespace
+
+std::tuple<Net, Marking> readPnmlStreaming(const std::set<std::string> &files) {
+  std::set<std::string> places, transitions;
+  Marking place_initialMarking;
+  Net state_net;
+  std::vector<PendingArc> arcs;
+
+  for (auto file : files) {
+    PnmlHandler handler(places, transitions, place_initialMarking, arcs);
+    parseXml(file, handler);
+    for (const auto &arc : arcs) {
+      const auto color = arc.color ? arc.color->c_str() : nullptr;
+      addArc(state_net, places, transitions, arc.id, arc.source, arc.target,
+             color, arc.multiplicity);
+    }
+    arcs.clear();
+  }
+
   return {state_net, place_initialMarking};
 }
+
 }  // namespace symmetri
@@ -0,0 +1,252 @@
+#include "symmetri/reactor.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+
+#include "petri.h"
+
+namespace symmetri {
+
+namespace {
+
+// the bits of the scheduling state of a net.
+constexpr uint8_t kScheduled = 1;  ///< it is queued or being processed
+constexpr uint8_t kPending = 2;  ///< a message arrived since it was processed
+constexpr uint8_t kDone = 4;     ///< it will not be processed again
+
+/**
+ * @brief The maximum amount of messages of a single net that is handled at
+ * once, so a busy net can not starve the other nets.
+ *
+ */
+constexpr size_t kBatchSize = 256;
+
+}  // namespace
+
+struct Reactor::Core {
+  /**
+   * @brief A net that is fired by the Reactor. It observes the Mailbox of the
+   * net, and queues itself for processing when a message arrives. The
+   * scheduling state guarantees that it is queued at most once, so a net is
+   * never processed by two threads at the same time.
+   *
+   */
+  struct Case final : MailboxObserver, std::enable_shared_from_this<Case> {
+    Case(Core &_core, const PetriNet &_net, Handler &&_handler)
+        : core(_core), net(_net), handler(std::move(_handler)) {}
+
+    void notify() override {
+      const auto previous =
+          flags.fetch_or(kScheduled | kPending, std::memory_order_acq_rel);
+      if ((previous & (kScheduled | kDone)) == 0) {
+        core.ready.enqueue(shared_from_this());
+      }
+    }
+
+    Petri &petri() const { return *net->impl; }
+
+    Core &core;
+    std::optional<PetriNet> net;  ///< It is released once the net is done, as
+                                  ///< a sender that notified the Case may hold
+                                  ///< it for longer, e.g. a thread of the
+                                  ///< TaskSystem of the net.
+    Handler handler;
+    std::atomic<uint8_t> flags{0};
+    bool is_stopped = false;   ///< the scheduled Callbacks are canceled
+    bool is_canceled = false;  ///< the Reactor canceled it, guarded by mutex
+    Clock::time_point wake_up =
+        Clock::time_point::max();  ///< when it is notified for its timers
+  };
+
+  explicit Core(size_t thread_count)
+      : timers(kTimerResolution, Clock::now()) {
+    threads.reserve(std::max<size_t>(thread_count, 1));
+    for (size_t i = 0; i < threads.capacity(); i++) {
+      threads.emplace_back([this] { run(); });
+    }
+  }
+
+  ~Core() noexcept {
+    std::unique_lock<std::mutex> lock(mutex);
+    // a handler may fire a net again, so this is repeated until no net is
+    // left.
+    while (!cases.empty()) {
+      for (const auto &c : cases) {
+        if (!c->is_canceled) {
+          c->is_canceled = true;
+          cancel(*c->net);
+        }
+      }
+      is_done.wait(lock);
+    }
+    lock.unlock();
+    for (size_t i = 0; i < threads.size(); i++) {
+      ready.enqueue(nullptr);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  /**
+   * @brief The event-loop of a thread of the Reactor. A nullptr stops it.
+   *
+   */
+  void run() {
+    std::shared_ptr<Case> c;
+    while (true) {
+      if (!ready.wait_dequeue_timed(c, wakeUp())) {
+        continue;
+      } else if (c == nullptr) {
+        return;
+      } else if (process(*c)) {
+        // the net is queued again behind the other nets.
+        ready.enqueue(std::move(c));
+      }
+    }
+  }
+
+  /**
+   * @brief Notifies the nets of which the wake-up time passed.
+   *
+   * @return std::int64_t the time until the next wake-up in microseconds,
+   * negative if there is none
+   */
+  std::int64_t wakeUp() {
+    std::vector<std::weak_ptr<Case>> due;
+    std::int64_t timeout = -1;
+    {
+      std::lock_guard<std::mutex> lock(timer_mutex);
+      const auto now = Clock::now();
+      timers.expire(now, [&due](std::weak_ptr<Case> &&c) {
+        due.push_back(std::move(c));
+      });
+      if (const auto deadline = timers.nextDeadline()) {
+        timeout = std::max<std::int64_t>(
+            std::chrono::ceil<std::chrono::microseconds>(*deadline - now)
+                .count(),
+            0);
+      }
+    }
+    for (const auto &c : due) {
+      if (const auto locked = c.lock()) {
+        locked->notify();
+      }
+    }
+    return timeout;
+  }
+
+  /**
+   * @brief Handles the messages of a net and fires its active transitions.
+   *
+   * @param c
+   * @return true if the net has to be processed again
+   */
+  bool process(Case &c) {
+    // messages that arrive from here on set the flag again.
+    c.flags.fetch_and(~kPending, std::memory_order_acq_rel);
+    auto &m = c.petri();
+    const auto n = m.mailbox->receive(m, 0, kBatchSize);
+    const auto expired = m.expireTimers(Clock::now());
+    if (!c.is_stopped) {
+      if ((n > 0 || expired > 0) && m.isActive()) {
+        m.update();
+      }
+      if (!m.isActive()) {
+        m.stop();
+        c.is_stopped = true;
+      }
+    }
+
+    if (c.is_stopped && m.scheduled_callbacks.empty()) {
+      finish(c);
+      return false;
+    }
+    // the net is notified when its next timer expires, unless an earlier
+    // notification is pending.
+    const auto deadline = m.nextDeadline();
+    if (deadline && (*deadline < c.wake_up || c.wake_up <= Clock::now())) {
+      c.wake_up = *deadline;
+      std::lock_guard<std::mutex> lock(timer_mutex);
+      timers.schedule(*deadline, c.weak_from_this());
+    }
+    auto expected = kScheduled;
+    return n == kBatchSize ||
+           !c.flags.compare_exchange_strong(expected, 0,
+                                            std::memory_order_acq_rel);
+  }
+
+  /**
+   * @brief Marks the net as not fired and calls its handler.
+   *
+   * @param c
+   */
+  void finish(Case &c) {
+    c.flags.store(kDone, std::memory_order_release);
+    c.petri().mailbox->observe(nullptr);
+    c.petri().thread_id_.store(std::nullopt);
+    // the handler is called before the net is forgotten, so a Reactor that is
+    // destroyed also waits for the nets that are fired again by a handler.
+    const auto handler = std::move(c.handler);
+    handler(c.petri().state);
+    std::lock_guard<std::mutex> lock(mutex);
+    cases.erase(c.shared_from_this());
+    c.net.reset();
+    is_done.notify_all();
+  }
+
+  moodycamel::BlockingConcurrentQueue<std::shared_ptr<Case>>
+      ready;  ///< The nets that have to be processed.
+  mutable std::mutex mutex;
+  std::condition_variable is_done;
+  std::unordered_set<std::shared_ptr<Case>> cases;  ///< The nets that are
+                                                    ///< fired, by mutex.
+  std::mutex timer_mutex;
+  TimerWheel<std::weak_ptr<Case>>
+      timers;  ///< The wake-ups of the nets with timers, by timer_mutex.
+  std::vector<std::thread> threads;
+};
+
+Reactor::Reactor(size_t thread_count)
+    : core_(std::make_unique<Core>(thread_count)) {}
+
+Reactor::~Reactor() noexcept = default;
+
+void Reactor::fire(const PetriNet &net, Handler handler) {
+  auto &m = *net.impl;
+  if (m.thread_id_.load().has_value()) {
+    handler(Failed);
+    return;
+  }
+  m.thread_id_.store(getThreadId());
+  const auto c =
+      std::make_shared<Core::Case>(*core_, net, std::move(handler));
+  {
+    std::lock_guard<std::mutex> lock(core_->mutex);
+    core_->cases.insert(c);
+  }
+  // the net is marked as scheduled until it is started, so messages that
+  // arrive meanwhile can not queue it before it is ready.
+  c->flags.store(kScheduled, std::memory_order_relaxed);
+  m.mailbox->observe(c);
+  m.start();
+  core_->ready.enqueue(c);
+}
+
+size_t Reactor::size() const {
+  std::lock_guard<std::mutex> lock(core_->mutex);
+  return core_->cases.size();
+}
+
+std::future<Token> fireAsync(const PetriNet &net, Reactor &reactor) {
+  // a Handler has to be copyable, so the promise is shared.
+  auto result = std::make_shared<std::promise<Token>>();
+  auto future = result->get_future();
+  reactor.fire(net, [result](Token state) { result->set_value(state); });
+  return future;
+}
+
+}  // namespace symmetri
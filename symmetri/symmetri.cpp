@@ -8,46 +8,63 @@
 
 namespace symmetri {
 
+std::shared_ptr<const Topology> createTopology(
+    const std::set<std::string> &files, const Marking &final_marking,
+    const PriorityTable &priorities) {
+  // get the first file;
+  const std::filesystem::path pn_file = *files.begin();
+  if (pn_file.extension() == ".pnml") {
+    const auto [net, m0] = readPnml(files);
+    return std::make_shared<const Topology>(net, priorities, m0,
+                                            final_marking);
+  } else {
+    const auto [net, m0, specific_priorities] = readGrml(files);
+    return std::make_shared<const Topology>(net, specific_priorities, m0,
+                                            final_marking);
+  }
+}
+
+std::shared_ptr<const Topology> createTopology(
+    const Net &net, const Marking &initial_marking,
+    const Marking &final_marking, const PriorityTable &priorities) {
+  return std::make_shared<const Topology>(net, priorities, initial_marking,
+                                          final_marking);
+}
+
 PetriNet::PetriNet(const std::set<std::string> &files,
                    const std::string &case_id,
                    std::shared_ptr<TaskSystem> threadpool,
                    const Marking &final_marking,
                    const PriorityTable &priorities)
-    : impl([&] {
-        // get the first file;
-        const std::filesystem::path pn_file = *files.begin();
-        if (pn_file.extension() == ".pnml") {
-          const auto [net, m0] = readPnml(files);
-          return std::make_shared<Petri>(net, priorities, m0, final_marking,
-                                         case_id, threadpool);
-        } else {
-          const auto [net, m0, specific_priorities] = readGrml(files);
-          return std::make_shared<Petri>(net, specific_priorities, m0,
-                                         final_marking, case_id, threadpool);
-        }
-      }()) {}
+    : PetriNet(createTopology(files, final_marking, priorities), case_id,
+               threadpool) {}
 
 PetriNet::PetriNet(const Net &net, const std::string &case_id,
                    std::shared_ptr<TaskSystem> threadpool,
                    const Marking &initial_marking, const Marking &final_marking,
                    const PriorityTable &priorities)
-    : impl(std::make_shared<Petri>(net, priorities, initial_marking,
-                                   final_marking, case_id, threadpool)) {}
+    : PetriNet(createTopology(net, initial_marking, final_marking, priorities),
+               case_id, threadpool) {}
+
+PetriNet::PetriNet(std::shared_ptr<const Topology> topology,
+                   const std::string &case_id,
+                   std::shared_ptr<TaskSystem> threadpool)
+    : impl(std::make_shared<Petri>(std::move(topology), case_id, threadpool)) {}
 
 std::function<void()> PetriNet::getInputTransitionHandle(
     const Transition &transition) const noexcept {
-  const auto t_index = toIndex(impl->net.transition, transition);
+  const auto t_index = toIndex(impl->net.transition_index, transition);
   // if the transition has input places, you can not register a callback like
   // this, we simply return a non-functioning handle.
-  if (!impl->net.input_n[t_index].empty()) {
+  if (t_index >= impl->net.transition.size() ||
+      !impl->net.input_n[t_index].empty()) {
     return []() -> void {};
   } else {
     return [t_index, this]() -> void {
       if (impl->thread_id_.load()) {
-        impl->reducer_queue->enqueue([=](Petri &m) {
+        impl->mailbox->send([=](Petri &m) {
           m.scheduled_callbacks.push_back(t_index);
-          m.reducer_queue->enqueue(
-              scheduleCallback(t_index, m.net.store[t_index], m.reducer_queue));
+          m.mailbox->send(runCallback(t_index, m.store[t_index]));
         });
       }
     };
@@ -57,15 +74,59 @@ std::function<void()> PetriNet::getInputTransitionHandle(
 void PetriNet::registerCallback(const std::string &transition,
                                 const Callback &callback) const noexcept {
   if (!impl->thread_id_.load().has_value()) {
-    impl->net.registerCallback(transition, callback);
+    impl->registerCallback(transition, callback);
+  }
+}
+
+void PetriNet::setDelay(const std::string &transition,
+                        Clock::duration delay) const noexcept {
+  if (!impl->thread_id_.load().has_value()) {
+    impl->setDelay(transition, delay);
+  }
+}
+
+void PetriNet::setDeadline(const std::string &transition,
+                           Clock::duration deadline,
+                           const Token &timeout) const noexcept {
+  if (!impl->thread_id_.load().has_value()) {
+    impl->setDeadline(transition, deadline, timeout);
+  }
+}
+
+void PetriNet::setFireAffinity(const std::vector<unsigned> &cpus) const {
+  if (impl->thread_id_.load().has_value()) {
+    return;
+  }
+  const auto available = availableCpus();
+  for (const auto cpu : cpus) {
+    if (std::find(available.begin(), available.end(), cpu) ==
+        available.end()) {
+      throw std::runtime_error("cpu " + std::to_string(cpu) +
+                               " is not available");
+    }
+  }
+  impl->fire_cpus = cpus;
+}
+
+void PetriNet::setWaitPolicy(const WaitPolicy &wait_policy) const noexcept {
+  if (!impl->thread_id_.load().has_value()) {
+    impl->wait_policy = wait_policy;
   }
 }
 
+void PetriNet::setShareWeight(unsigned weight) const noexcept {
+  impl->share->setWeight(weight);
+}
+
+Share::Stats PetriNet::getQueueStats() const noexcept {
+  return impl->share->stats();
+}
+
 Marking PetriNet::getMarking() const noexcept {
   if (impl->thread_id_.load()) {
     std::promise<Marking> el;
     std::future<Marking> el_getter = el.get_future();
-    impl->reducer_queue->enqueue(
+    impl->mailbox->send(
         [&](Petri &model) { el.set_value(model.getMarking()); });
     return el_getter.get();
   } else {
@@ -1,37 +1,1035 @@
 #include "symmetri/tasks.h"
 
-#include "externals/blockingconcurrentqueue.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include "externals/concurrentqueue.h"
+#include "externals/lightweightsemaphore.h"
 
 namespace symmetri {
 
+using Task = TaskSystem::Task;
+
+/**
+ * @brief TaskQueue distributes the tasks that are pushed to a TaskSystem over
+ * its threads.
+ *
+ */
+class TaskQueue {
+ public:
+  virtual ~TaskQueue() = default;
+
+  /**
+   * @brief Queues a task. It is thread-safe.
+   *
+   * @param task
+   * @param priority
+   * @param share the Share of the task, which may be nullptr
+   */
+  virtual void push(Task &&task, int priority,
+                    const std::shared_ptr<Share> &share) = 0;
+
+  /**
+   * @brief Queues count tasks of the same priority and Share at once. It is
+   * thread-safe.
+   *
+   * @param tasks the tasks, which are moved from
+   * @param count
+   * @param priority
+   * @param share the Share of the tasks, which may be nullptr
+   */
+  virtual void pushBulk(Task *tasks, size_t count, int priority,
+                        const std::shared_ptr<Share> &share) = 0;
+
+  /**
+   * @brief Blocks until there is a task for the worker.
+   *
+   * @param worker the index of the thread in the pool
+   * @param task is assigned the task that is to be executed
+   * @return true if task is assigned, false if the queue is stopped
+   */
+  virtual bool pop(size_t worker, Task &task) = 0;
+
+  /**
+   * @brief Stops the queue; tasks that were not yet started are discarded.
+   *
+   */
+  virtual void stop() = 0;
+};
+
+namespace {
+
+/**
+ * @brief The index of the highest set bit of a non-zero value.
+ *
+ */
+size_t highestBit(uint64_t bits) {
+  size_t bit = 0;
+  for (size_t shift = 32; shift > 0; shift /= 2) {
+    if ((bits >> shift) != 0) {
+      bits >>= shift;
+      bit += shift;
+    }
+  }
+  return bit;
+}
+
+/**
+ * @brief SharedQueue is shared by all workers and holds a lock-free queue per
+ * priority, which is created once the first task of that priority is pushed;
+ * priorities are clamped to the range of int8_t. A worker takes the oldest
+ * task of the highest priority with queued tasks. Tasks age: every
+ * kAgingInterval-th task that a worker takes comes from the next lower
+ * priority with queued tasks in round-robin order instead, so a steady stream
+ * of high priority tasks can not starve tasks of a lower priority. The
+ * workers wait on a semaphore that counts the queued tasks.
+ *
+ */
+class SharedQueue final : public TaskQueue {
+ public:
+  static constexpr size_t kAgingInterval = 64;
+
+  SharedQueue(size_t worker_count, WaitPolicy wait_policy)
+      : worker_count_(worker_count),
+        poll_count_(wait_policy.pollCount()),
+        take_counts_(std::max<size_t>(worker_count, 1)),
+        tasks_(0, 0),
+        is_stopped_(false) {
+    for (auto &level : levels_) {
+      level.store(nullptr, std::memory_order_relaxed);
+    }
+    for (auto &bits : non_empty_) {
+      bits.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ~SharedQueue() override {
+    for (auto &level : levels_) {
+      delete level.load(std::memory_order_relaxed);
+    }
+  }
+
+  void push(Task &&task, int priority,
+            const std::shared_ptr<Share> &) override {
+    const auto level = levelOf(priority);
+    queue(level).enqueue(std::move(task));
+    markNonEmpty(level);
+    tasks_.signal();
+  }
+
+  void pushBulk(Task *tasks, size_t count, int priority,
+                const std::shared_ptr<Share> &) override {
+    if (count == 0) {
+      return;
+    }
+    const auto level = levelOf(priority);
+    queue(level).enqueue_bulk(std::make_move_iterator(tasks), count);
+    markNonEmpty(level);
+    tasks_.signal(static_cast<Semaphore::ssize_t>(count));
+  }
+
+  bool pop(size_t worker, Task &task) override {
+    bool has_task = tasks_.tryWait();
+    for (size_t i = 0; !has_task && i < poll_count_; i++) {
+      WaitPolicy::relax();
+      has_task = tasks_.tryWait();
+    }
+    if (!has_task) {
+      tasks_.wait();
+    }
+    if (is_stopped_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    // the semaphore counted a task for this worker, so there is one to take,
+    // even if other workers empty the level it looks at first.
+    const bool is_aging = ++take_counts_[worker].count % kAgingInterval == 0;
+    while (!take(task, is_aging)) {
+      WaitPolicy::relax();
+    }
+    return true;
+  }
+
+  void stop() override {
+    is_stopped_.store(true, std::memory_order_release);
+    tasks_.signal(static_cast<Semaphore::ssize_t>(worker_count_));
+  }
+
+ private:
+  using Queue = moodycamel::ConcurrentQueue<Task>;
+  using Semaphore = moodycamel::LightweightSemaphore;
+  static constexpr size_t kLevelCount = 256;
+
+  struct alignas(64) TakeCount {
+    size_t count = 0;  ///< the amount of tasks the worker took
+  };
+
+  static size_t levelOf(int priority) {
+    return static_cast<size_t>(std::clamp(priority, -128, 127) + 128);
+  }
+
+  /**
+   * @brief The queue of a level, which is created if it does not exist yet.
+   *
+   */
+  Queue &queue(size_t level) {
+    auto queue = levels_[level].load(std::memory_order_acquire);
+    if (queue == nullptr) {
+      auto created = std::make_unique<Queue>(256);
+      if (levels_[level].compare_exchange_strong(queue, created.get(),
+                                                 std::memory_order_acq_rel)) {
+        queue = created.release();
+      }
+    }
+    return *queue;
+  }
+
+  void markNonEmpty(size_t level) {
+    non_empty_[level / 64].fetch_or(uint64_t(1) << (level % 64),
+                                    std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief The highest level at or below from that may hold tasks.
+   *
+   * @return kLevelCount if there is none
+   */
+  size_t highestLevel(size_t from) const {
+    for (size_t word = from / 64 + 1; word-- > 0;) {
+      auto bits = non_empty_[word].load(std::memory_order_acquire);
+      if (word == from / 64 && from % 64 != 63) {
+        bits &= (uint64_t(2) << (from % 64)) - 1;
+      }
+      if (bits != 0) {
+        return word * 64 + highestBit(bits);
+      }
+    }
+    return kLevelCount;
+  }
+
+  /**
+   * @brief Takes the oldest task of the highest level with tasks, or, if
+   * is_aging, of the level after the previously aged one.
+   *
+   * @return false if the level it looked at was empty
+   */
+  bool take(Task &task, bool is_aging) {
+    auto level = kLevelCount;
+    if (is_aging) {
+      level = highestLevel(aging_level_.load(std::memory_order_relaxed));
+    }
+    if (level == kLevelCount) {
+      level = highestLevel(kLevelCount - 1);
+    }
+    if (level == kLevelCount) {
+      return false;
+    } else if (is_aging) {
+      aging_level_.store(level == 0 ? kLevelCount - 1 : level - 1,
+                         std::memory_order_relaxed);
+    }
+    auto &queue = *levels_[level].load(std::memory_order_acquire);
+    if (queue.try_dequeue(task)) {
+      return true;
+    }
+    // the level ran empty; it is marked again if a task was pushed meanwhile.
+    non_empty_[level / 64].fetch_and(~(uint64_t(1) << (level % 64)),
+                                     std::memory_order_seq_cst);
+    if (queue.size_approx() > 0) {
+      markNonEmpty(level);
+    }
+    return false;
+  }
+
+  const size_t worker_count_;
+  const size_t poll_count_;
+  std::array<std::atomic<Queue *>, kLevelCount>
+      levels_;  ///< the queues per level, owned
+  std::array<std::atomic<uint64_t>, kLevelCount / 64>
+      non_empty_;  ///< a bit per level that may hold tasks
+  std::atomic<size_t> aging_level_{kLevelCount - 1};  ///< the next aged level
+  std::vector<TakeCount> take_counts_;  ///< per worker
+  Semaphore tasks_;  ///< counts the queued tasks
+  std::atomic<bool> is_stopped_;
+};
+
+/**
+ * @brief The queue and index of the worker that runs on this thread, if any.
+ *
+ */
+struct LocalWorker {
+  const TaskQueue *queue;
+  size_t index;
+};
+
+thread_local LocalWorker local_worker = {nullptr, 0};
+
+/**
+ * @brief Parking blocks the workers that found no task until tasks are
+ * pushed. The sequentially consistent increment of the sleeper count in park
+ * and its load in wake pair with the sequentially consistent store and load
+ * of the amount of queued tasks by the queue: either a parking worker sees the
+ * new tasks, or the pushing thread sees the parking worker.
+ *
+ */
+class Parking {
+ public:
+  /**
+   * @brief Blocks until wake or stop is called, unless hasTasks returns true.
+   *
+   * @param hasTasks loads the amount of queued tasks sequentially consistent
+   */
+  template <typename HasTasks>
+  void park(HasTasks hasTasks) {
+    const auto epoch = epoch_.load(std::memory_order_relaxed);
+    sleeper_count_.fetch_add(1, std::memory_order_seq_cst);
+    if (!hasTasks()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] {
+        return epoch_.load(std::memory_order_relaxed) != epoch ||
+               is_stopped_.load(std::memory_order_relaxed);
+      });
+    }
+    sleeper_count_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Wakes up to count parked workers. It is called after the tasks
+   * are queued.
+   *
+   */
+  void wake(size_t count) {
+    const auto sleeper_count = sleeper_count_.load(std::memory_order_seq_cst);
+    if (sleeper_count == 0 || count == 0) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (count >= sleeper_count) {
+      cv_.notify_all();
+    } else {
+      for (size_t i = 0; i < count; i++) {
+        cv_.notify_one();
+      }
+    }
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopped_.store(true, std::memory_order_release);
+    }
+    cv_.notify_all();
+  }
+
+  bool isStopped() const { return is_stopped_.load(std::memory_order_acquire); }
+
+ private:
+  std::atomic<size_t> sleeper_count_{0};
+  std::atomic<uint64_t> epoch_{0};  ///< is incremented to wake parked workers
+  std::atomic<bool> is_stopped_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+/**
+ * @brief PriorityDeque holds tasks per priority. The task with the highest
+ * priority is taken first and tasks of the same priority are taken in FIFO
+ * order. Tasks age: a task is overtaken by at most kAgingInterval later tasks
+ * per level that their priority is higher, so a steady stream of high
+ * priority tasks can not starve tasks of a lower priority. The tasks of a
+ * priority are kept in a ring buffer that only grows, and a priority keeps its
+ * ring buffer once it is empty, so pushing and taking does not allocate once
+ * the buffers fit the deepest queue. It is not thread-safe.
+ *
+ */
+class PriorityDeque {
+ public:
+  static constexpr int64_t kAgingInterval = 64;
+
+  void push(Task &&task, int priority) {
+    auto level = std::find_if(
+        levels_.begin(), levels_.end(),
+        [=](const Level &level) { return level.priority <= priority; });
+    if (level == levels_.end() || level->priority != priority) {
+      level = levels_.insert(level, Level{priority});
+    }
+    level->push({std::move(task), sequence_++});
+    size_++;
+  }
+
+  bool take(Task &task) {
+    // the oldest task of every level competes; on a tie the higher priority
+    // wins.
+    Level *best = nullptr;
+    int64_t best_score = 0;
+    for (auto &level : levels_) {
+      if (level.count == 0) {
+        continue;
+      }
+      const auto score =
+          level.priority * kAgingInterval - level.front().sequence;
+      if (best == nullptr || score > best_score) {
+        best = &level;
+        best_score = score;
+      }
+    }
+    if (best == nullptr) {
+      return false;
+    }
+    task = std::move(best->front().task);
+    best->pop();
+    size_--;
+    return true;
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  struct Entry {
+    Task task;
+    int64_t sequence;  ///< the order in which the tasks were pushed
+  };
+
+  /**
+   * @brief The tasks of one priority in a ring buffer of which the capacity
+   * is a power of two.
+   *
+   */
+  struct Level {
+    int priority;
+    std::vector<Entry> entries = {};
+    size_t head = 0;   ///< the position of the oldest task
+    size_t count = 0;  ///< the amount of queued tasks
+
+    Entry &front() { return entries[head]; }
+
+    void push(Entry &&entry) {
+      if (count == entries.size()) {
+        std::vector<Entry> grown(std::max<size_t>(2 * count, 16));
+        for (size_t i = 0; i < count; i++) {
+          grown[i] = std::move(entries[(head + i) & (count - 1)]);
+        }
+        entries = std::move(grown);
+        head = 0;
+      }
+      entries[(head + count) & (entries.size() - 1)] = std::move(entry);
+      count++;
+    }
+
+    void pop() {
+      head = (head + 1) & (entries.size() - 1);
+      count--;
+    }
+  };
+
+  std::vector<Level> levels_;  ///< the tasks per priority, highest first
+  int64_t sequence_ = 0;
+  size_t size_ = 0;
+};
+
 /**
- * @brief An alias for the implementation. In this case
- * moodycamel::BlockingConcurrentQueue.
+ * @brief WorkStealingQueue gives every worker its own PriorityDeque. Tasks
+ * that are pushed by a worker go to its own deque, other tasks are spread
+ * round-robin over the deques. A worker takes the task with the highest
+ * (aged) priority of its own deque and once it is empty, it steals the same
+ * from another deque, starting at a random victim. Priorities are thus
+ * ordered per deque; a worker does not search all deques for the highest
+ * priority. A worker that found no task is parked until a new task is pushed,
+ * after polling as long as the WaitPolicy allows.
+ *
+ * If the workers are grouped per NUMA node, tasks from outside the pool are
+ * spread over the workers on the node of the pushing thread and workers steal
+ * from their own node before they steal from other nodes.
  *
  */
-using Queue = moodycamel::BlockingConcurrentQueue<TaskSystem::Task>;
+class WorkStealingQueue final : public TaskQueue {
+ public:
+  /**
+   * @brief Construct a new WorkStealingQueue object
+   *
+   * @param worker_count
+   * @param wait_policy
+   * @param worker_nodes the NUMA node of every worker, or empty if the
+   * workers are not grouped per node
+   */
+  WorkStealingQueue(size_t worker_count, WaitPolicy wait_policy,
+                    const std::vector<unsigned> &worker_nodes)
+      : deques_(std::max<size_t>(worker_count, 1)),
+        poll_count_(wait_policy.pollCount()) {
+    all_.workers.resize(deques_.size());
+    std::iota(all_.workers.begin(), all_.workers.end(), 0);
+    for (size_t i = 0; i < deques_.size(); i++) {
+      deques_[i].random = static_cast<uint32_t>(i + 1);
+      if (!worker_nodes.empty()) {
+        const auto node = worker_nodes[i];
+        const auto it = std::find_if(
+            nodes_.begin(), nodes_.end(),
+            [=](const Group &group) { return group.node == node; });
+        auto &group = it == nodes_.end() ? nodes_.emplace_back() : *it;
+        group.node = node;
+        group.workers.push_back(i);
+        deques_[i].group = &group;
+      }
+    }
+  }
+
+  void push(Task &&task, int priority,
+            const std::shared_ptr<Share> &) override {
+    size_t worker = local_worker.index;
+    if (local_worker.queue != this) {
+      auto &group = pushingGroup();
+      const auto next = group.next.fetch_add(1, std::memory_order_relaxed);
+      worker = group.workers[next % group.workers.size()];
+    }
+    auto &deque = deques_[worker];
+    {
+      std::lock_guard<std::mutex> lock(deque.mutex);
+      deque.tasks.push(std::move(task), priority);
+      deque.size.store(deque.tasks.size(), std::memory_order_seq_cst);
+    }
+    parking_.wake(1);
+  }
+
+  void pushBulk(Task *tasks, size_t count, int priority,
+                const std::shared_ptr<Share> &) override {
+    if (local_worker.queue == this) {
+      auto &deque = deques_[local_worker.index];
+      std::lock_guard<std::mutex> lock(deque.mutex);
+      for (size_t i = 0; i < count; i++) {
+        deque.tasks.push(std::move(tasks[i]), priority);
+      }
+      deque.size.store(deque.tasks.size(), std::memory_order_seq_cst);
+    } else {
+      // the same distribution as count single pushes, but every deque is
+      // locked only once.
+      auto &group = pushingGroup();
+      const auto n = group.workers.size();
+      const auto first = group.next.fetch_add(count, std::memory_order_relaxed);
+      for (size_t i = 0; i < std::min(count, n); i++) {
+        auto &deque = deques_[group.workers[(first + i) % n]];
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        for (size_t j = i; j < count; j += n) {
+          deque.tasks.push(std::move(tasks[j]), priority);
+        }
+        deque.size.store(deque.tasks.size(), std::memory_order_seq_cst);
+      }
+    }
+    parking_.wake(count);
+  }
+
+  bool pop(size_t worker, Task &task) override {
+    local_worker = {this, worker};
+    while (true) {
+      for (size_t i = 0;; i++) {
+        if (parking_.isStopped()) {
+          return false;
+        } else if (take(worker, task) || steal(worker, task)) {
+          return true;
+        } else if (i >= poll_count_) {
+          break;
+        }
+        WaitPolicy::relax();
+      }
+
+      parking_.park([this] { return hasTasks(); });
+    }
+  }
+
+  void stop() override { parking_.stop(); }
+
+ private:
+  /**
+   * @brief A set of workers that receive the tasks that are pushed from
+   * outside the pool in round-robin order.
+   *
+   */
+  struct Group {
+    unsigned node = 0;  ///< the NUMA node of the workers
+    std::vector<size_t> workers;
+    std::atomic<size_t> next{0};  ///< the position of the next push
+  };
+
+  struct alignas(64) Deque {
+    std::mutex mutex;
+    PriorityDeque tasks;
+    std::atomic<size_t> size{0};  ///< lets thieves skip empty deques
+    uint32_t random;  ///< the state of the victim selection of the owner
+    const Group *group = nullptr;  ///< the NUMA group of the owner, if any
+  };
+
+  /**
+   * @brief The group that receives the tasks pushed by this thread: the
+   * workers on the same NUMA node, or all workers.
+   *
+   */
+  Group &pushingGroup() {
+    if (!nodes_.empty()) {
+#ifdef __linux__
+      const auto cpu = sched_getcpu();
+      const auto node = cpu < 0 ? 0 : numaNode(static_cast<unsigned>(cpu));
+      for (auto &group : nodes_) {
+        if (group.node == node) {
+          return group;
+        }
+      }
+#endif
+    }
+    return all_;
+  }
+
+  bool take(size_t worker, Task &task) {
+    auto &deque = deques_[worker];
+    if (deque.size.load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    if (!deque.tasks.take(task)) {
+      return false;
+    }
+    deque.size.store(deque.tasks.size(), std::memory_order_relaxed);
+    return true;
+  }
+
+  bool steal(size_t worker, Task &task) {
+    // xorshift; the victims are visited in order, starting at a random one.
+    auto &random = deques_[worker].random;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    const auto steal_from = [&](const Group &group) {
+      const auto n = group.workers.size();
+      for (size_t i = 0; i < n; i++) {
+        const auto victim = group.workers[(random + i) % n];
+        if (victim != worker && take(victim, task)) {
+          return true;
+        }
+      }
+      return false;
+    };
+    const auto group = deques_[worker].group;
+    return (group != nullptr && steal_from(*group)) || steal_from(all_);
+  }
+
+  bool hasTasks() const {
+    return std::any_of(deques_.begin(), deques_.end(), [](const Deque &d) {
+      return d.size.load(std::memory_order_seq_cst) > 0;
+    });
+  }
+
+  std::vector<Deque> deques_;
+  const size_t poll_count_;
+  Group all_;                ///< all workers
+  std::deque<Group> nodes_;  ///< the workers per NUMA node, if grouped
+  Parking parking_;
+};
 
 /**
- * @brief TaskQueue is an inheritance based alias for a lock-free queue.
+ * @brief FairShareQueue keeps a PriorityDeque per Share and serves the Shares
+ * with queued tasks by stride scheduling: every Share has a pass, the Share
+ * with the lowest pass gives the next task, after which its pass advances by
+ * kStride divided by its weight. A Share thus gets tasks taken in proportion
+ * to its weight, however many tasks it queued. A Share that becomes active
+ * starts at the pass of the last served Share, so idling does not build up
+ * credit.
+ *
+ * The queues of the Shares are spread over kShardCount shards, each with its
+ * own lock, so threads that push for different Shares rarely contend. The
+ * single lock of the queue only guards the order of the Shares, an intrusive
+ * binary heap: a worker picks the Share with the lowest pass under it and
+ * takes the task under the lock of the shard of that Share. A Share keeps its
+ * queue while it idles, so a stable set of Shares queues and takes tasks
+ * without allocating. A shard drops its idle queues once it holds twice as
+ * many queues as after they were last dropped.
  *
  */
-class TaskQueue : public Queue {
-  using Queue::Queue;
+class FairShareQueue final : public TaskQueue {
+ public:
+  explicit FairShareQueue(WaitPolicy wait_policy)
+      : poll_count_(wait_policy.pollCount()) {}
+
+  void push(Task &&task, int priority,
+            const std::shared_ptr<Share> &share) override {
+    pushBulk(&task, 1, priority, share);
+  }
+
+  void pushBulk(Task *tasks, size_t count, int priority,
+                const std::shared_ptr<Share> &share) override {
+    if (count == 0) {
+      return;
+    }
+    auto &shard = shards_[shardOf(share.get())];
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto &flow = findFlow(shard, share);
+      for (size_t i = 0; i < count; i++) {
+        flow.tasks.push(std::move(tasks[i]), priority);
+      }
+      if (share) {
+        share->recordPush(count);
+      }
+      size_.fetch_add(count, std::memory_order_seq_cst);
+      if (flow.ready.fetch_add(count, std::memory_order_relaxed) == 0) {
+        std::lock_guard<std::mutex> order_lock(mutex_);
+        flow.pass = pass_;
+        flow.sequence = sequence_++;
+        flow.position = heap_.size();
+        heap_.push_back(&flow);
+        siftUp(flow.position);
+      }
+    }
+    parking_.wake(count);
+  }
+
+  bool pop(size_t, Task &task) override {
+    while (true) {
+      for (size_t i = 0;; i++) {
+        if (parking_.isStopped()) {
+          return false;
+        } else if (size_.load(std::memory_order_acquire) > 0 && take(task)) {
+          return true;
+        } else if (i >= poll_count_) {
+          break;
+        }
+        WaitPolicy::relax();
+      }
+      parking_.park(
+          [this] { return size_.load(std::memory_order_seq_cst) > 0; });
+    }
+  }
+
+  void stop() override { parking_.stop(); }
+
+ private:
+  static constexpr uint64_t kStride = uint64_t(1) << 20;
+  static constexpr size_t kShardCount = 16;
+  static constexpr size_t kIdle = SIZE_MAX;  ///< the position of idle flows
+
+  struct Shard;
+
+  struct Flow {
+    std::shared_ptr<Share> share;  ///< nullptr for tasks without a Share
+    Shard *shard = nullptr;
+    PriorityDeque tasks;  ///< by the mutex of the shard
+    std::atomic<size_t> ready{0};  ///< the tasks that are not yet picked
+    uint64_t pass = 0;             ///< by mutex_
+    uint64_t sequence = 0;  ///< the arrival, which breaks ties, by mutex_
+    size_t position = kIdle;  ///< the position in the heap, by mutex_
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::unordered_map<const Share *, Flow> flows;  ///< by mutex
+    size_t drop_limit = 16;  ///< the amount of flows that are kept, by mutex
+  };
+
+  static size_t shardOf(const Share *share) {
+    // Fibonacci hashing; the low bits of the addresses are mostly equal.
+    const auto hash =
+        reinterpret_cast<uintptr_t>(share) * uint64_t(0x9E3779B97F4A7C15);
+    return static_cast<size_t>(hash >> 60) % kShardCount;
+  }
+
+  /**
+   * @brief The queue of a Share, which is created if it does not exist. The
+   * lock of the shard must be held.
+   *
+   */
+  Flow &findFlow(Shard &shard, const std::shared_ptr<Share> &share) {
+    const auto it = shard.flows.find(share.get());
+    if (it != shard.flows.end()) {
+      return it->second;
+    }
+    if (shard.flows.size() >= shard.drop_limit) {
+      // a flow without tasks is idle: its last task is taken, so no worker
+      // refers to it anymore.
+      for (auto flow = shard.flows.begin(); flow != shard.flows.end();) {
+        flow = flow->second.tasks.size() == 0 ? shard.flows.erase(flow)
+                                              : std::next(flow);
+      }
+      shard.drop_limit = std::max<size_t>(2 * shard.flows.size(), 16);
+    }
+    auto &flow = shard.flows[share.get()];
+    flow.share = share;
+    flow.shard = &shard;
+    return flow;
+  }
+
+  static bool isBefore(const Flow *a, const Flow *b) {
+    return std::tie(a->pass, a->sequence) < std::tie(b->pass, b->sequence);
+  }
+
+  void place(Flow *flow, size_t position) {
+    heap_[position] = flow;
+    flow->position = position;
+  }
+
+  void siftUp(size_t position) {
+    const auto flow = heap_[position];
+    while (position > 0 && isBefore(flow, heap_[(position - 1) / 2])) {
+      place(heap_[(position - 1) / 2], position);
+      position = (position - 1) / 2;
+    }
+    place(flow, position);
+  }
+
+  void siftDown(size_t position) {
+    const auto flow = heap_[position];
+    while (true) {
+      auto child = 2 * position + 1;
+      if (child >= heap_.size()) {
+        break;
+      } else if (child + 1 < heap_.size() &&
+                 isBefore(heap_[child + 1], heap_[child])) {
+        child++;
+      }
+      if (!isBefore(heap_[child], flow)) {
+        break;
+      }
+      place(heap_[child], position);
+      position = child;
+    }
+    place(flow, position);
+  }
+
+  /**
+   * @brief Picks the Share with the lowest pass under the lock of the queue
+   * and takes one of its tasks under the lock of its shard. The picked task
+   * is queued, as a flow counts a task as ready once it is queued.
+   *
+   * @return false if there are no tasks
+   */
+  bool take(Task &task) {
+    Flow *flow;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (heap_.empty()) {
+        return false;
+      }
+      flow = heap_.front();
+      pass_ = flow->pass;
+      if (flow->ready.fetch_sub(1, std::memory_order_relaxed) == 1) {
+        flow->position = kIdle;
+        const auto last = heap_.back();
+        heap_.pop_back();
+        if (last != flow) {
+          place(last, 0);
+          siftDown(0);
+        }
+      } else {
+        const auto weight = flow->share ? flow->share->weight() : 1u;
+        flow->pass += kStride / weight;
+        flow->sequence = sequence_++;
+        siftDown(0);
+      }
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(flow->shard->mutex);
+    flow->tasks.take(task);
+    if (flow->share) {
+      flow->share->recordTake();
+    }
+    return true;
+  }
+
+  const size_t poll_count_;
+  std::array<Shard, kShardCount> shards_;
+  std::mutex mutex_;
+  std::vector<Flow *>
+      heap_;  ///< the flows with tasks by pass and arrival, by mutex_
+  uint64_t pass_ = 0;      ///< the pass of the last served Share, by mutex_
+  uint64_t sequence_ = 0;  ///< by mutex_
+  std::atomic<size_t> size_{0};  ///< the tasks that are not yet picked
+  Parking parking_;
 };
 
-TaskSystem::TaskSystem(size_t thread_count)
-    : pool_(thread_count),
-      is_running_(false),
-      queue_(std::make_unique<TaskQueue>(256)) {
-  std::generate(std::begin(pool_), std::end(pool_),
-                [this] { return std::thread(&TaskSystem::loop, this); });
+std::unique_ptr<TaskQueue> createTaskQueue(
+    size_t thread_count, TaskSystem::Scheduler scheduler,
+    WaitPolicy wait_policy, const std::vector<unsigned> &worker_nodes) {
+  switch (scheduler) {
+    case TaskSystem::Scheduler::SharedQueue:
+      return std::make_unique<SharedQueue>(thread_count, wait_policy);
+    case TaskSystem::Scheduler::FairShare:
+      return std::make_unique<FairShareQueue>(wait_policy);
+    case TaskSystem::Scheduler::WorkStealing:
+    default:
+      return std::make_unique<WorkStealingQueue>(thread_count, wait_policy,
+                                                 worker_nodes);
+  }
+}
+
+/**
+ * @brief Parses a list of CPUs in the format of the kernel, e.g. "0-3,8,10".
+ *
+ */
+std::vector<unsigned> parseCpuList(const std::string &list) {
+  std::vector<unsigned> cpus;
+  size_t begin = 0;
+  while (begin < list.size()) {
+    const auto end = std::min(list.find(',', begin), list.size());
+    const auto range = list.substr(begin, end - begin);
+    const auto dash = range.find('-');
+    const auto first = std::stoul(range.substr(0, dash));
+    const auto last =
+        dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+    for (auto cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(static_cast<unsigned>(cpu));
+    }
+    begin = end + 1;
+  }
+  return cpus;
 }
 
-TaskSystem::~TaskSystem() noexcept {
-  is_running_.store(true, std::memory_order_release);
-  for (size_t i = 0; i < pool_.size(); ++i) {
-    queue_->enqueue([] {});
+/**
+ * @brief The CPU of every thread of a TaskSystem, or an empty vector if the
+ * threads are not pinned.
+ *
+ */
+std::vector<unsigned> placeThreads(size_t thread_count,
+                                   const Placement &placement) {
+  auto cpus = placement.cpus;
+  const auto available = availableCpus();
+  if (cpus.empty() && placement.numa_aware) {
+    // consecutive threads share a node.
+    cpus = available;
+    std::stable_sort(cpus.begin(), cpus.end(), [](unsigned a, unsigned b) {
+      return numaNode(a) < numaNode(b);
+    });
+  }
+  for (const auto cpu : cpus) {
+    if (std::find(available.begin(), available.end(), cpu) ==
+        available.end()) {
+      throw std::runtime_error("cpu " + std::to_string(cpu) +
+                               " is not available");
+    }
+  }
+  std::vector<unsigned> thread_cpus;
+  for (size_t i = 0; i < thread_count && !cpus.empty(); i++) {
+    thread_cpus.push_back(cpus[i % cpus.size()]);
+  }
+  return thread_cpus;
+}
+
+}  // namespace
+
+std::vector<unsigned> availableCpus() {
+  std::vector<unsigned> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+    return cpus;
+  }
+#endif
+  cpus.resize(std::max(std::thread::hardware_concurrency(), 1u));
+  std::iota(cpus.begin(), cpus.end(), 0);
+  return cpus;
+}
+
+unsigned numaNode(unsigned cpu) {
+  // the topology does not change while running, so it is read once.
+  static const std::vector<unsigned> nodes = [] {
+    std::vector<unsigned> nodes;
+    const std::filesystem::path root = "/sys/devices/system/node";
+    std::error_code error;
+    for (const auto &entry :
+         std::filesystem::directory_iterator(root, error)) {
+      const auto name = entry.path().filename().string();
+      if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+          !std::all_of(name.begin() + 4, name.end(), [](char c) {
+            return std::isdigit(static_cast<unsigned char>(c)) != 0;
+          })) {
+        continue;
+      }
+      std::ifstream file(entry.path() / "cpulist");
+      std::string list;
+      if (std::getline(file, list)) {
+        for (const auto c : parseCpuList(list)) {
+          nodes.resize(std::max<size_t>(nodes.size(), c + 1), 0);
+          nodes[c] = static_cast<unsigned>(std::stoul(name.substr(4)));
+        }
+      }
+    }
+    return nodes;
+  }();
+  return cpu < nodes.size() ? nodes[cpu] : 0;
+}
+
+bool setThreadAffinity(const std::vector<unsigned> &cpus) noexcept {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  return !cpus.empty() &&
+         pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+void WaitPolicy::relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield");
+#endif
+}
+
+TaskSystem::TaskSystem(size_t thread_count, Scheduler scheduler,
+                       WaitPolicy wait_policy, const Placement &placement) {
+  const auto cpus = placeThreads(thread_count, placement);
+  std::vector<unsigned> nodes;
+  if (placement.numa_aware) {
+    std::transform(cpus.begin(), cpus.end(), std::back_inserter(nodes),
+                   numaNode);
+  }
+  queue_ = createTaskQueue(thread_count, scheduler, wait_policy, nodes);
+  pool_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; i++) {
+    std::vector<unsigned> cpu;
+    if (!cpus.empty()) {
+      cpu.push_back(cpus[i]);
+    }
+    pool_.emplace_back([this, i, cpu = std::move(cpu)] {
+      // the CPUs are validated, so pinning only fails in exotic setups in
+      // which the thread simply runs unpinned.
+      if (!cpu.empty()) {
+        setThreadAffinity(cpu);
+      }
+      loop(i);
+    });
   }
+}
+
+TaskSystem::~TaskSystem() noexcept {
+  queue_->stop();
   for (auto &t : pool_) {
     if (t.joinable()) {
       t.join();
@@ -39,20 +1037,55 @@ TaskSystem::~TaskSystem() noexcept {
   }
 }
 
-void TaskSystem::loop() {
+void TaskSystem::loop(size_t worker) {
   while (true) {
-    Task transition;
-    if (queue_->wait_dequeue_timed(transition, -1)) {
-      if (is_running_.load(std::memory_order_acquire)) {
-        break;
-      }
-      transition();
+    Task task;
+    if (!queue_->pop(worker, task)) {
+      break;
     }
+    task();
+  }
+}
+
+void TaskSystem::push(Task &&p, int priority,
+                      const std::shared_ptr<Share> &share) const {
+  queue_->push(std::forward<Task>(p), priority, share);
+}
+
+void TaskSystem::pushBulk(Task *tasks, size_t count, int priority,
+                          const std::shared_ptr<Share> &share) const {
+  queue_->pushBulk(tasks, count, priority, share);
+}
+
+Share::Share(unsigned weight) noexcept
+    : weight_(std::max(weight, 1u)), queued_(0), peak_(0), started_(0) {}
+
+void Share::setWeight(unsigned weight) noexcept {
+  weight_.store(std::max(weight, 1u), std::memory_order_relaxed);
+}
+
+unsigned Share::weight() const noexcept {
+  return weight_.load(std::memory_order_relaxed);
+}
+
+Share::Stats Share::stats() const noexcept {
+  return {queued_.load(std::memory_order_relaxed),
+          peak_.load(std::memory_order_relaxed),
+          started_.load(std::memory_order_relaxed)};
+}
+
+void Share::recordPush(size_t count) noexcept {
+  const auto queued =
+      queued_.fetch_add(count, std::memory_order_relaxed) + count;
+  auto peak = peak_.load(std::memory_order_relaxed);
+  while (queued > peak && !peak_.compare_exchange_weak(
+                              peak, queued, std::memory_order_relaxed)) {
   }
 }
 
-void TaskSystem::push(Task &&p) const {
-  queue_->enqueue(std::forward<Task>(p));
+void Share::recordTake() noexcept {
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+  started_.fetch_add(1, std::memory_order_relaxed);
 }
 
 }  // namespace symmetri
@@ -0,0 +1,63 @@
+#include <atomic>
+
+#include "doctest/doctest.h"
+#include "petri.h"
+
+using namespace symmetri;
+
+// see counting_allocator.cpp
+extern std::atomic<bool> is_counting_allocations;
+extern std::atomic<size_t> allocation_count;
+
+namespace {
+
+// a deferred Callback that completes right away through its Completer.
+struct Deferred {};
+bool isDeferred(const Deferred &) { return true; }
+Token fire(const Deferred &) { return Success; }
+void fire(const Deferred &, Completer &&completer) { completer(Success); }
+
+// fires the transitions of the net and applies the completions of their
+// Callbacks until count Callbacks completed.
+void fireUntil(Petri &m, size_t count) {
+  size_t completed = 0;
+  m.fireTransitions();
+  while (completed < count) {
+    completed += m.mailbox->receive(m, -1);
+    m.fireTransitions();
+  }
+}
+
+// applies the completions of the Callbacks that are still running.
+void drain(Petri &m) {
+  while (!m.scheduled_callbacks.empty()) {
+    m.mailbox->receive(m, -1);
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Firing a warm net asynchronously does not allocate") {
+  // t0 runs on the pool and t1 is deferred.
+  for (const auto scheduler :
+       {TaskSystem::Scheduler::SharedQueue, TaskSystem::Scheduler::WorkStealing,
+        TaskSystem::Scheduler::FairShare}) {
+    // the tokens move back and forth between Pa and Pb.
+    const Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}},
+                     {"t1", {{{"Pb", Success}}, {{"Pa", Success}}}}};
+    auto pool = std::make_shared<TaskSystem>(2, scheduler);
+    Petri m(net, {{"t0", 1}}, Marking(4, {"Pa", Success}), {}, "s", pool);
+    m.registerCallback("t0", [] {});
+    m.registerCallback("t1", Deferred{});
+
+    // the queues and the event log grow to their steady-state size.
+    fireUntil(m, 3000);
+    m.log.clear();
+
+    is_counting_allocations = true;
+    fireUntil(m, 1000);
+    is_counting_allocations = false;
+    CHECK(allocation_count.exchange(0) == 0);
+    drain(m);
+  }
+}
@@ -35,17 +35,14 @@ TEST_CASE("Firing the same transition before it can complete should work") {
   auto [net, priority, m0] = BugsTestNet();
   auto threadpool = std::make_shared<TaskSystem>(2);
   Petri m(net, priority, m0, {}, "s", threadpool);
-  m.net.registerCallback("t", &t);
+  m.registerCallback("t", &t);
 
   CHECK(m.scheduled_callbacks.empty());
   m.fireTransitions();
   CHECK(m.getMarking().empty());
   CHECK(m.scheduled_callbacks.size() == 2);
 
-  Reducer r;
-  while (
-      m.reducer_queue->wait_dequeue_timed(r, std::chrono::milliseconds(250))) {
-    r(m);
+  while (m.mailbox->receive(m, 250000) > 0) {
   }
 
   {
@@ -55,8 +52,7 @@ TEST_CASE("Firing the same transition before it can complete should work") {
 
   cv.notify_one();
 
-  m.reducer_queue->wait_dequeue_timed(r, std::chrono::milliseconds(250));
-  r(m);
+  m.mailbox->receive(m, 250000, 1);
   {
     Marking expected = {{"Pb", Success}};
     CHECK(MarkingEquality(m.getMarking(), expected));
@@ -69,8 +65,7 @@ TEST_CASE("Firing the same transition before it can complete should work") {
     is_ready2 = true;
   }
   cv.notify_one();
-  m.reducer_queue->wait_dequeue_timed(r, std::chrono::milliseconds(250));
-  r(m);
+  m.mailbox->receive(m, 250000, 1);
   {
     Marking expected = {{"Pb", Success}, {"Pb", Success}};
     CHECK(MarkingEquality(m.getMarking(), expected));
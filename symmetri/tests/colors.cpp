@@ -18,18 +18,14 @@ TEST_CASE("Test color.") {
   auto threadpool = std::make_shared<TaskSystem>(1);
   Petri m(net, priority, m0, mgoal, "s", threadpool);
 
-  m.net.registerCallback("t0", &red);
+  m.registerCallback("t0", &red);
 
   for (auto [p, c] : m.getMarking()) {
     std::cout << p << ", " << c.toIndex() << std::endl;
   }
   // t0 is enabled.
   m.fireTransitions();
-  Reducer r1;
-  CHECK(m.reducer_queue->wait_dequeue_timed(r1, std::chrono::seconds(1)));
-  r1(m);
-  CHECK(m.reducer_queue->wait_dequeue_timed(r1, std::chrono::seconds(1)));
-  r1(m);
+  CHECK(m.mailbox->receive(m, 1000000, 1) == 1);
 
   const auto marking = m.getMarking();
   // processed but post are not:
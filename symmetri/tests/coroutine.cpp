@@ -0,0 +1,168 @@
+#include "symmetri/coroutine.h"
+
+#include <atomic>
+#include <thread>
+
+#include "doctest/doctest.h"
+#include "symmetri/symmetri.h"
+
+using namespace symmetri;
+
+namespace {
+
+// an awaitable event; the coroutines that wait for it are resumed by the
+// thread that opens it.
+class Gate {
+ public:
+  struct Awaiter {
+    bool await_ready() {
+      std::lock_guard<std::mutex> lock(gate.mutex_);
+      return gate.is_open_;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::lock_guard<std::mutex> lock(gate.mutex_);
+      if (!gate.is_open_) {
+        gate.waiting_.push_back(handle);
+      }
+      return !gate.is_open_;
+    }
+    void await_resume() {}
+    Gate &gate;
+  };
+
+  Awaiter wait() { return {*this}; }
+
+  void open() {
+    std::vector<std::coroutine_handle<>> waiting;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_open_ = true;
+      waiting.swap(waiting_);
+    }
+    for (auto handle : waiting) {
+      handle.resume();
+    }
+  }
+
+  size_t waiting() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waiting_.size();
+  }
+
+ private:
+  std::mutex mutex_;
+  bool is_open_ = false;
+  std::vector<std::coroutine_handle<>> waiting_;
+};
+
+void waitUntil(const std::function<bool()> &condition) {
+  while (!condition()) {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Suspended coroutines do not hold a thread of the pool.") {
+  // four transitions wait for a fifth, which would deadlock a single thread
+  // if they blocked.
+  Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}},
+             {"t1", {{{"Pa", Success}}, {{"Pb", Success}}}},
+             {"t2", {{{"Pa", Success}}, {{"Pb", Success}}}},
+             {"t3", {{{"Pa", Success}}, {{"Pb", Success}}}},
+             {"open", {{{"Pc", Success}}, {}}}};
+  Marking initial = {{"Pa", Success}, {"Pa", Success}, {"Pa", Success},
+                     {"Pa", Success}, {"Pc", Success}};
+  Marking goal = {{"Pb", Success}, {"Pb", Success}, {"Pb", Success},
+                  {"Pb", Success}};
+  PriorityTable priorities = {{"open", -1}};
+  auto pool = std::make_shared<TaskSystem>(1);
+  PetriNet app(net, "coroutines", pool, initial, goal, priorities);
+
+  Gate gate;
+  std::atomic<int> on_pool{0};
+  const CoroutineCallback wait_for_gate([&]() -> AsyncToken {
+    co_await gate.wait();
+    co_await resumeOn(*pool);
+    on_pool++;
+    co_return Success;
+  });
+  for (const auto &t : {"t0", "t1", "t2", "t3"}) {
+    app.registerCallback(t, wait_for_gate);
+  }
+  app.registerCallback("open", [&] {
+    waitUntil([&] { return gate.waiting() == 4; });
+    gate.open();
+  });
+
+  CHECK(fire(app) == Success);
+  CHECK(on_pool == 4);
+}
+
+TEST_CASE("A canceled coroutine stops once it resumes.") {
+  Net net = {{"t", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  auto pool = std::make_shared<TaskSystem>(1);
+  PetriNet app(net, "cancel", pool, {{"Pa", Success}}, {{"Pb", Success}});
+  Gate gate;
+  bool is_continued = false;
+  app.registerCallback("t", CoroutineCallback([&]() -> AsyncToken {
+                         co_await gate.wait();
+                         is_continued = true;
+                         co_return Success;
+                       }));
+
+  Token result = Scheduled;
+  std::thread firing([&] { result = fire(app); });
+  waitUntil([&] { return gate.waiting() == 1; });
+  cancel(app);
+  // the coroutine is canceled once its run is logged as canceled.
+  waitUntil([&] {
+    const auto log = getLog(app);
+    return !log.empty() && log.back().state == Canceled;
+  });
+  gate.open();
+  firing.join();
+  CHECK(result == Canceled);
+  CHECK(!is_continued);
+  const auto log = getLog(app);
+  CHECK(log.back().transition == "t");
+  CHECK(log.back().state == Canceled);
+}
+
+TEST_CASE("A paused coroutine waits at its next co_await.") {
+  Net net = {{"t", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  auto pool = std::make_shared<TaskSystem>(1);
+  PetriNet app(net, "pause", pool, {{"Pa", Success}}, {{"Pb", Success}});
+  Gate gate;
+  std::atomic<int> step{0};
+  app.registerCallback("t", CoroutineCallback([&]() -> AsyncToken {
+                         co_await gate.wait();
+                         step = 1;
+                         co_await resumeOn(*pool);
+                         step = 2;
+                         co_return Success;
+                       }));
+
+  Token result = Scheduled;
+  std::thread firing([&] { result = fire(app); });
+  waitUntil([&] { return gate.waiting() == 1; });
+  pause(app);
+  getLog(app);  // returns after the pause is handled
+  gate.open();
+  CHECK(step == 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  CHECK(step == 1);
+  resume(app);
+  firing.join();
+  CHECK(step == 2);
+  CHECK(result == Success);
+}
+
+TEST_CASE("A coroutine that throws fails.") {
+  const CoroutineCallback callback([]() -> AsyncToken {
+    throw std::runtime_error("oops");
+    co_return Success;
+  });
+  CHECK(isDeferred(Callback(callback)));
+  CHECK(fire(callback) == Failed);
+}
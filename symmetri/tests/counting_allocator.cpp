@@ -0,0 +1,53 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// the allocations of all threads are counted while is_counting_allocations is
+// set. The operators are replaced in their own file of the allocation tests,
+// so the other tests run on the allocator of the standard library.
+std::atomic<bool> is_counting_allocations(false);
+std::atomic<size_t> allocation_count(0);
+
+namespace {
+
+void *allocate(size_t size) noexcept {
+  if (is_counting_allocations.load(std::memory_order_relaxed)) {
+    allocation_count++;
+  }
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+  if (auto memory = allocate(size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete[](void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
@@ -0,0 +1,219 @@
+#include <atomic>
+#include <future>
+#include <thread>
+
+#include "doctest/doctest.h"
+#include "symmetri/reactor.h"
+#include "symmetri/symmetri.h"
+
+using namespace symmetri;
+
+CREATE_CUSTOM_TOKEN(TimedOut)
+
+namespace {
+
+// a Callback that only completes once it is canceled.
+struct Stuck {
+  std::shared_ptr<std::atomic<bool>> is_canceled =
+      std::make_shared<std::atomic<bool>>(false);
+};
+
+Token fire(const Stuck &stuck) {
+  while (!stuck.is_canceled->load()) {
+    std::this_thread::yield();
+  }
+  return Canceled;
+}
+
+void cancel(const Stuck &stuck) { stuck.is_canceled->store(true); }
+
+// a transition that moves the token of Pa to Pb.
+PetriNet deadlineNet(const std::shared_ptr<TaskSystem> &pool,
+                     const Token &goal) {
+  return PetriNet({{"t", {{{"Pa", Success}}, {{"Pb", Success}}}}},
+                  "deadline", pool, {{"Pa", Success}}, {{"Pb", goal}});
+}
+
+// a Callback that sleeps, and flags that it started.
+auto sleeper(Clock::duration duration,
+             std::shared_ptr<std::atomic<bool>> is_started =
+                 std::make_shared<std::atomic<bool>>(false)) {
+  return [duration, is_started] {
+    is_started->store(true);
+    std::this_thread::sleep_for(duration);
+  };
+}
+
+// a Callback of which the first run is stuck until it is canceled, and of
+// which later runs take a while.
+struct FirstStuck {
+  std::shared_ptr<std::atomic<size_t>> runs =
+      std::make_shared<std::atomic<size_t>>(0);
+  std::shared_ptr<std::atomic<size_t>> returns =
+      std::make_shared<std::atomic<size_t>>(0);
+  std::shared_ptr<std::atomic<bool>> is_canceled =
+      std::make_shared<std::atomic<bool>>(false);
+};
+
+Token fire(const FirstStuck &callback) {
+  if ((*callback.runs)++ == 0) {
+    const auto give_up = Clock::now() + std::chrono::seconds(1);
+    while (!callback.is_canceled->load() && Clock::now() < give_up) {
+      std::this_thread::yield();
+    }
+    (*callback.returns)++;
+    return Canceled;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  (*callback.returns)++;
+  return callback.is_canceled->load() ? Token(Canceled) : Token(Success);
+}
+
+void cancel(const FirstStuck &callback) {
+  callback.is_canceled->store(true);
+}
+
+}  // namespace
+
+TEST_CASE("A Callback that misses its deadline produces the timeout Token.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  auto net = deadlineNet(pool, TimedOut);
+  net.registerCallback("t", sleeper(std::chrono::milliseconds(300)));
+  net.setDeadline("t", std::chrono::milliseconds(10), TimedOut);
+  const auto begin = Clock::now();
+  CHECK(fire(net) == Success);
+  CHECK(Clock::now() - begin < std::chrono::milliseconds(200));
+  CHECK(net.getMarking() == Marking{{"Pb", TimedOut}});
+  const auto log = getLog(net);
+  CHECK(log.back().state == TimedOut);
+}
+
+TEST_CASE("A Callback that meets its deadline is not affected.") {
+  auto pool = std::make_shared<TaskSystem>(2);
+  auto net = deadlineNet(pool, Success);
+  net.registerCallback("t", sleeper(std::chrono::milliseconds(1)));
+  net.setDeadline("t", std::chrono::seconds(10), TimedOut);
+  CHECK(fire(net) == Success);
+  CHECK(net.getMarking() == Marking{{"Pb", Success}});
+}
+
+TEST_CASE("An expired deadline cancels the Callback.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  auto net = deadlineNet(pool, Failed);
+  const Stuck stuck;
+  net.registerCallback("t", stuck);
+  net.setDeadline("t", std::chrono::milliseconds(5));
+  CHECK(fire(net) == Success);
+  CHECK(stuck.is_canceled->load());
+  CHECK(net.getMarking() == Marking{{"Pb", Failed}});
+}
+
+TEST_CASE("A deadline bounds the wait for a Callback of a canceled net.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  auto net = deadlineNet(pool, Success);
+  auto is_started = std::make_shared<std::atomic<bool>>(false);
+  net.registerCallback("t",
+                       sleeper(std::chrono::milliseconds(500), is_started));
+  net.setDeadline("t", std::chrono::milliseconds(20));
+  Token result = Scheduled;
+  const auto begin = Clock::now();
+  std::thread firing([&] { result = fire(net); });
+  while (!is_started->load()) {
+    std::this_thread::yield();
+  }
+  cancel(net);
+  firing.join();
+  CHECK(result == Canceled);
+  CHECK(Clock::now() - begin < std::chrono::milliseconds(300));
+}
+
+TEST_CASE("A deadline does not produce the timeout Token after a cancel.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  auto net = deadlineNet(pool, Success);
+  auto is_started = std::make_shared<std::atomic<bool>>(false);
+  net.registerCallback("t",
+                       sleeper(std::chrono::milliseconds(200), is_started));
+  net.setDeadline("t", std::chrono::milliseconds(20), TimedOut);
+  Token result = Scheduled;
+  std::thread firing([&] { result = fire(net); });
+  while (!is_started->load()) {
+    std::this_thread::yield();
+  }
+  cancel(net);
+  firing.join();
+  CHECK(result == Canceled);
+  CHECK(net.getMarking().empty());
+  for (const auto &event : getLog(net)) {
+    CHECK(!(event.state == TimedOut));
+  }
+}
+
+TEST_CASE("Pausing a net freezes its deadlines.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  auto net = deadlineNet(pool, Success);
+  auto is_started = std::make_shared<std::atomic<bool>>(false);
+  net.registerCallback("t", sleeper(std::chrono::milliseconds(60), is_started));
+  net.setDeadline("t", std::chrono::milliseconds(40), TimedOut);
+  Token result = Scheduled;
+  std::thread firing([&] { result = fire(net); });
+  while (!is_started->load()) {
+    std::this_thread::yield();
+  }
+  pause(net);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  resume(net);
+  firing.join();
+  CHECK(result == Success);
+  CHECK(net.getMarking() == Marking{{"Pb", Success}});
+}
+
+TEST_CASE("A Reactor times out the Callbacks of its nets.") {
+  auto pool = std::make_shared<TaskSystem>(2);
+  auto net = deadlineNet(pool, TimedOut);
+  const Stuck stuck;
+  net.registerCallback("t", stuck);
+  net.setDeadline("t", std::chrono::milliseconds(5), TimedOut);
+  Reactor reactor;
+  CHECK(fireAsync(net, reactor).get() == Success);
+  CHECK(stuck.is_canceled->load());
+}
+
+TEST_CASE("A deadline only affects its own run.") {
+  // t fires right away, and again once the delayed u put a token in Pa. The
+  // first run times out while the second run is busy, which is not canceled,
+  // so the first run keeps running until it gives up.
+  auto pool = std::make_shared<TaskSystem>(2);
+  PetriNet net({{"t", {{{"Pa", Success}}, {{"Pb", Success}}}},
+                {"u", {{{"Pc", Success}}, {{"Pa", Success}}}}},
+               "runs", pool, {{"Pa", Success}, {"Pc", Success}},
+               {{"Pb", TimedOut}, {"Pb", Success}});
+  const FirstStuck callback;
+  net.registerCallback("t", callback);
+  net.setDelay("u", std::chrono::milliseconds(100));
+  net.setDeadline("t", std::chrono::milliseconds(200), TimedOut);
+  CHECK(fire(net) == Success);
+  CHECK(callback.runs->load() == 2);
+  CHECK(!callback.is_canceled->load());
+  CHECK(callback.returns->load() == 1);
+  while (callback.returns->load() < 2) {
+    std::this_thread::yield();
+  }
+}
+
+TEST_CASE("A run that times out before it started never starts.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  std::promise<void> gate;
+  auto is_open = gate.get_future().share();
+  pool->push([is_open] { is_open.wait(); });
+  auto net = deadlineNet(pool, TimedOut);
+  auto is_started = std::make_shared<std::atomic<bool>>(false);
+  net.registerCallback("t", sleeper(std::chrono::milliseconds(0), is_started));
+  net.setDeadline("t", std::chrono::milliseconds(10), TimedOut);
+  CHECK(fire(net) == Success);
+  gate.set_value();
+  // the tasks are executed in order, so the run was dropped once this ran.
+  std::promise<void> is_drained;
+  pool->push([&] { is_drained.set_value(); });
+  is_drained.get_future().wait();
+  CHECK(!is_started->load());
+}
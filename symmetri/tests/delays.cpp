@@ -0,0 +1,153 @@
+#include <random>
+#include <thread>
+
+#include "doctest/doctest.h"
+#include "symmetri/reactor.h"
+#include "symmetri/symmetri.h"
+#include "timer_wheel.h"
+
+using namespace symmetri;
+
+TEST_CASE("Timers of every level of the wheel expire in order.") {
+  const auto origin = Clock::now();
+  const auto resolution = std::chrono::microseconds(100);
+  TimerWheel<size_t> timers(resolution, origin);
+  std::mt19937 random(1);
+  std::vector<Clock::duration> deadlines;
+  for (size_t i = 0; i < 10000; i++) {
+    // up to 2^30 ticks, which spans all levels.
+    const auto ticks = random() % (size_t(1) << (random() % 31));
+    deadlines.push_back(resolution * ticks + std::chrono::microseconds(7));
+    timers.schedule(origin + deadlines.back(), i);
+  }
+  CHECK(timers.size() == deadlines.size());
+
+  std::vector<size_t> expired;
+  auto now = origin;
+  while (!timers.empty()) {
+    now = std::max(now + resolution, *timers.nextDeadline());
+    timers.expire(now, [&](size_t i) {
+      // never early and at most one tick late.
+      CHECK(origin + deadlines[i] <= now);
+      CHECK(origin + deadlines[i] + resolution > now);
+      expired.push_back(i);
+    });
+  }
+  CHECK(expired.size() == deadlines.size());
+  CHECK(std::is_sorted(expired.begin(), expired.end(), [&](auto a, auto b) {
+    return deadlines[a] < deadlines[b];
+  }));
+}
+
+TEST_CASE("A late expire returns all due timers at once.") {
+  const auto origin = Clock::now();
+  TimerWheel<int> timers(std::chrono::milliseconds(1), origin);
+  timers.schedule(origin - std::chrono::seconds(1), 0);
+  timers.schedule(origin + std::chrono::milliseconds(3), 1);
+  timers.schedule(origin + std::chrono::hours(2), 2);
+  CHECK(*timers.nextDeadline() == origin);
+  std::vector<int> expired;
+  const auto push = [&](int i) { expired.push_back(i); };
+  CHECK(timers.expire(origin + std::chrono::hours(1), push) == 2);
+  CHECK(expired == std::vector<int>{0, 1});
+  CHECK(timers.expire(origin + std::chrono::hours(2), push) == 1);
+  CHECK(timers.empty());
+  CHECK(!timers.nextDeadline());
+}
+
+namespace {
+
+// a transition that moves the tokens of Pa to Pb.
+PetriNet delayNet(const std::shared_ptr<TaskSystem> &pool, size_t tokens,
+                  Clock::duration delay) {
+  const Marking initial(tokens, {"Pa", Success});
+  const Marking goal(tokens, {"Pb", Success});
+  PetriNet net({{"t", {{{"Pa", Success}}, {{"Pb", Success}}}}}, "delay", pool,
+               initial, goal);
+  net.setDelay("t", delay);
+  return net;
+}
+
+}  // namespace
+
+TEST_CASE("A delayed transition starts its Callback after the delay.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  const auto delay = std::chrono::milliseconds(20);
+  for (const bool is_synchronous : {true, false}) {
+    auto net = delayNet(pool, 2, delay);
+    if (!is_synchronous) {
+      net.registerCallback("t", [] {});
+    }
+    const auto begin = Clock::now();
+    CHECK(fire(net) == Success);
+    CHECK(Clock::now() - begin >= delay);
+    const auto log = getLog(net);
+    for (const auto &event : log) {
+      if (event.state == Started) {
+        CHECK(event.stamp - log.front().stamp >= delay);
+      }
+    }
+  }
+}
+
+TEST_CASE("Many pending delays do not need threads.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  const size_t count = 100000;
+  auto net = delayNet(pool, count, std::chrono::milliseconds(50));
+  const auto begin = Clock::now();
+  CHECK(fire(net) == Success);
+  CHECK(Clock::now() - begin < std::chrono::seconds(10));
+  CHECK(net.getMarking().size() == count);
+}
+
+TEST_CASE("Pausing a net freezes its delays.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  const auto delay = std::chrono::milliseconds(40);
+  auto net = delayNet(pool, 1, delay);
+  // the net is started once fireAsync returns, so it can be paused.
+  Reactor reactor;
+  const auto begin = Clock::now();
+  auto result = fireAsync(net, reactor);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  pause(net);
+  const auto paused = Clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  CHECK(net.getMarking() == Marking{});
+  resume(net);
+  const auto resumed = Clock::now();
+  CHECK(result.get() == Success);
+  // the delay continues with the time that remained.
+  CHECK(Clock::now() - resumed >= delay - (paused - begin));
+}
+
+TEST_CASE("Canceling a net drops its delays.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  auto net = delayNet(pool, 3, std::chrono::hours(1));
+  Reactor reactor;
+  auto result = fireAsync(net, reactor);
+  while (getLog(net).size() < 3) {
+    std::this_thread::yield();
+  }
+  cancel(net);
+  CHECK(result.get() == Canceled);
+  CHECK(net.getMarking() == Marking{});
+}
+
+TEST_CASE("A Reactor wakes up nets with delays.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  const auto delay = std::chrono::milliseconds(10);
+  std::vector<PetriNet> nets;
+  for (size_t i = 0; i < 10; i++) {
+    nets.push_back(delayNet(pool, 1, delay * (i % 3 + 1)));
+  }
+  Reactor reactor;
+  std::vector<std::future<Token>> results;
+  const auto begin = Clock::now();
+  for (const auto &net : nets) {
+    results.push_back(fireAsync(net, reactor));
+  }
+  for (auto &result : results) {
+    CHECK(result.get() == Success);
+  }
+  CHECK(Clock::now() - begin >= delay * 3);
+}
@@ -0,0 +1,130 @@
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "doctest/doctest.h"
+#include "petri.h"
+#include "symmetri/symmetri.h"
+#include "symmetri/utilities.hpp"
+
+using namespace symmetri;
+
+CREATE_CUSTOM_TOKEN(Green)
+
+namespace {
+
+std::string tempFile(const std::string &name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+template <typename T>
+bool equal(Span<T> a, Span<T> b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+bool equal(const SmallArc &a, const SmallArc &b) {
+  return a.place == b.place && a.weight == b.weight && a.color == b.color;
+}
+
+bool equal(const Csr<SmallArc> &a, const Csr<SmallArc> &b) {
+  return a.size() == b.size() && equal(a.offsets(), b.offsets()) &&
+         std::equal(a.values().begin(), a.values().end(), b.values().begin(),
+                    b.values().end(),
+                    [](const auto &x, const auto &y) { return equal(x, y); });
+}
+
+// overwrites a value at an offset in a file.
+template <typename T>
+void patch(const std::string &path, size_t offset, const T &value) {
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(offset);
+  file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+}  // namespace
+
+TEST_CASE("A topology is restored from its binary representation") {
+  Net net = {{"t0", {{{"Pa", Success}, {"Pb", Green, 2}}, {{"Pc", Success}}}},
+             {"t1", {{{"Pc", Success}}, {{"Pb", Green}, {"Pd", Success}}}}};
+  Marking initial = {{"Pa", Success}, {"Pa", Success}, {"Pb", Green},
+                     {"Pb", Green}};
+  // the tokens that t1 produces take the color of its result.
+  Marking goal = {{"Pa", Success}, {"Pb", Success}, {"Pd", Success}};
+  PriorityTable priority = {{"t0", 1}, {"t1", -2}};
+  const auto path = tempFile("symmetri_restore.symnet");
+  const auto original = createTopology(net, initial, goal, priority);
+  saveTopology(original, path);
+  const auto loaded = loadTopology(path);
+
+  CHECK(loaded->transition == original->transition);
+  CHECK(loaded->place == original->place);
+  CHECK(loaded->priority == original->priority);
+  CHECK(equal(loaded->input_n, original->input_n));
+  CHECK(equal(loaded->output_n, original->output_n));
+  CHECK(equal(loaded->p_to_ts_n.offsets(), original->p_to_ts_n.offsets()));
+  CHECK(equal(loaded->p_to_ts_n.values(), original->p_to_ts_n.values()));
+  CHECK(loaded->initial_tokens == original->initial_tokens);
+  CHECK(loaded->final_marking == original->final_marking);
+  CHECK(toIndex(loaded->transition_index, "t1") ==
+        toIndex(original->transition_index, "t1"));
+
+  // the loaded topology can be run.
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  PetriNet app(loaded, "binary", threadpool);
+  CHECK(fire(app) == Success);
+  CHECK(MarkingEquality(app.getMarking(), goal));
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("A binary net without a goal marking never reaches its goal") {
+  Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  const auto path = tempFile("symmetri_no_goal.symnet");
+  saveTopology(createTopology(net, {{"Pa", Success}}), path);
+  const auto loaded = loadTopology(path);
+  CHECK(loaded->final_marking.empty());
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Loading an invalid binary net throws") {
+  CHECK_THROWS(loadTopology(tempFile("symmetri_does_not_exist.symnet")));
+
+  const auto path = tempFile("symmetri_invalid.symnet");
+  {
+    std::ofstream file(path);
+    file << "this is not a binary net, but it is long enough to be one.";
+  }
+  CHECK_THROWS(loadTopology(path));
+
+  // a truncated file is rejected.
+  Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  saveTopology(createTopology(net, {{"Pa", Success}}), path);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+  CHECK_THROWS(loadTopology(path));
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Loading a binary net with inconsistent arcs throws") {
+  static_assert(sizeof(SmallArc) == 16, "the offsets below assume this");
+  Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  const auto topology = createTopology(net, {{"Pa", Success}});
+  const auto path = tempFile("symmetri_inconsistent.symnet");
+  // the single input arc follows the header of 56 bytes and the two input
+  // offsets of t0.
+  const size_t input_arc = 56 + 8;
+  const auto place = static_cast<uint32_t>(topology->input_n[0][0].place);
+
+  // an arc with a color that is not in the color table.
+  saveTopology(topology, path);
+  patch(path, input_arc + 8, uint64_t(Failed.toIndex()));
+  CHECK_THROWS_AS(loadTopology(path), std::runtime_error);
+
+  // an arc from a place that does not list the transition in its lookup.
+  saveTopology(topology, path);
+  patch(path, input_arc, uint32_t(1 - place));
+  CHECK_THROWS_AS(loadTopology(path), std::runtime_error);
+
+  // the unmodified file loads.
+  saveTopology(topology, path);
+  CHECK(loadTopology(path)->input_n[0][0].place == place);
+  std::filesystem::remove(path);
+}
@@ -1,4 +1,6 @@
 #include <filesystem>
+#include <fstream>
+#include <stdexcept>
 
 #include "doctest/doctest.h"
 #include "symmetri/parsers.h"
@@ -83,6 +85,12 @@ TEST_CASE("Load p1_multi.pnml net") {
       {{"P0", Success}, {"P1", Success}, {"P2", Success}, {"P3", Success}}};
   net_test["t4"] = {{{"P7", Success}}, {{"P8", Success}}};
   CHECK(stateNetEquality(net_test, net));
+
+  // the weight is not expanded into duplicated arcs.
+  const auto &t3_inputs = net.at("t3").first;
+  CHECK(t3_inputs.size() == 2);
+  CHECK(std::find(t3_inputs.begin(), t3_inputs.end(),
+                  Arc{"P6", Success, 2}) != t3_inputs.end());
 }
 
 TEST_CASE("Compose PT1.pnml and PT2.pnml nets") {
@@ -106,3 +114,97 @@ TEST_CASE("Compose PT1.pnml and PT2.pnml nets") {
 
   // CHECK(net_test == net);
 }
+
+TEST_CASE("The streaming parsers give the same result as the DOM parsers") {
+  const auto asset = [](const std::string &file) -> std::string {
+    return std::filesystem::current_path().append(
+        "../../../symmetri/tests/assets/" + file);
+  };
+  const std::vector<std::set<std::string>> pnml_files = {
+      {asset("n1.pnml")},
+      {asset("n1_multi.pnml")},
+      {asset("PT1.pnml"), asset("PT2.pnml")}};
+  for (const auto &files : pnml_files) {
+    const auto &[net, m0] = readPnml(files);
+    const auto &[streamed_net, streamed_m0] = readPnmlStreaming(files);
+    CHECK(net == streamed_net);
+    CHECK(m0 == streamed_m0);
+  }
+
+  const auto &[net, m0, priorities] = readGrml({asset("n1.grml")});
+  const auto &[streamed_net, streamed_m0, streamed_priorities] =
+      readGrmlStreaming({asset("n1.grml")});
+  CHECK(net == streamed_net);
+  CHECK(m0 == streamed_m0);
+  CHECK(priorities == streamed_priorities);
+}
+
+TEST_CASE("The streaming parser handles the xml constructs of pnml-files") {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "symmetri_stream.pnml")
+          .string();
+  {
+    std::ofstream file(path);
+    file << R"(<?xml version="1.0"?>
+<!DOCTYPE pnml [ <!ELEMENT pnml ANY> ]>
+<pnml><net id="n"><page id="p">
+  <!-- arcs can precede the nodes they connect -->
+  <arc id="a0" source="P&amp;0" target="t>0">
+    <inscription><text>2</text></inscription>
+  </arc>
+  <arc id='a1' source='t>0' target='P1'/>
+  <place id="P&amp;0">
+    <initialMarking><text><![CDATA[3]]></text></initialMarking>
+  </place>
+  <place id="P1" />
+  <transition id="t&#62;0"></transition>
+</page></net></pnml>)";
+  }
+  const auto &[net, m0] = readPnmlStreaming({path});
+  Net expected = {{"t>0", {{{"P&0", Success, 2}}, {{"P1", Success}}}}};
+  CHECK(net == expected);
+  CHECK(m0 == Marking(3, {"P&0", Success}));
+
+  {
+    std::ofstream file(path);
+    file << "<pnml><net><page><place id=\"P0\"></page></net></pnml>";
+  }
+  CHECK_THROWS(readPnmlStreaming({path}));
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Invalid character references are rejected") {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "symmetri_reference.pnml")
+          .string();
+  for (const auto reference :
+       {"&#;", "&#x;", "&#0;", "&#xD800;", "&#xFFFFFFFF;", "&#x110000;",
+        "&#1a;", "&#-1;", "&#99999999999999999999;"}) {
+    {
+      std::ofstream file(path);
+      file << "<pnml><net><page><place id=\"P" << reference
+           << "\"/></page></net></pnml>";
+    }
+    CHECK_THROWS_AS(readPnmlStreaming({path}), std::runtime_error);
+  }
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Arcs with a multiplicity less than 1 are rejected") {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "symmetri_multiplicity.pnml")
+          .string();
+  {
+    std::ofstream file(path);
+    file << R"(<pnml><net id="n"><page id="p">
+  <place id="P0"/>
+  <transition id="t0"/>
+  <arc id="a0" source="P0" target="t0">
+    <inscription><text>0</text></inscription>
+  </arc>
+</page></net></pnml>)";
+  }
+  CHECK_THROWS_AS(readPnml({path}), std::runtime_error);
+  CHECK_THROWS_AS(readPnmlStreaming({path}), std::runtime_error);
+  std::filesystem::remove(path);
+}
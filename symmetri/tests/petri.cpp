@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <map>
+#include <stdexcept>
+#include <thread>
 
 #include "doctest/doctest.h"
 #include "symmetri/utilities.hpp"
@@ -57,8 +59,8 @@ TEST_CASE("Run one transition iteration in a petri net") {
 
   auto threadpool = std::make_shared<TaskSystem>(1);
   Petri m(net, priority, m0, {}, "s", threadpool);
-  m.net.registerCallback("t0", &petri0);
-  m.net.registerCallback("t1", &petri1);
+  m.registerCallback("t0", &petri0);
+  m.registerCallback("t1", &petri1);
 
   // t0 is enabled.
   m.fireTransitions();
@@ -68,12 +70,10 @@ TEST_CASE("Run one transition iteration in a petri net") {
     Marking expected = {{"Pa", Success}, {"Pa", Success}};
     CHECK(MarkingEquality(m.getMarking(), expected));
   }
-  // now there should be two reducers;
-  Reducer r1, r2;
-  CHECK(m.reducer_queue->wait_dequeue_timed(r1, std::chrono::seconds(1)));
-  CHECK(m.reducer_queue->wait_dequeue_timed(r1, std::chrono::seconds(1)));
-  CHECK(m.reducer_queue->wait_dequeue_timed(r2, std::chrono::seconds(1)));
-  CHECK(m.reducer_queue->wait_dequeue_timed(r2, std::chrono::seconds(1)));
+  // now there should be two completions;
+  while (T0_COUNTER.load() < 2) {
+    std::this_thread::yield();
+  }
   // verify that t0 has actually ran twice.
   CHECK(T0_COUNTER.load() == 2);
   // the marking should still be the same.
@@ -82,9 +82,9 @@ TEST_CASE("Run one transition iteration in a petri net") {
     CHECK(MarkingEquality(m.getMarking(), expected));
   }
 
-  // process the reducers
-  r1(m);
-  r2(m);
+  // process the completions
+  CHECK(m.mailbox->receive(m, 1000000, 1) == 1);
+  CHECK(m.mailbox->receive(m, 1000000, 1) == 1);
   // and now the post-conditions are processed:
   CHECK(m.scheduled_callbacks.empty());
   {
@@ -100,16 +100,14 @@ TEST_CASE("Run until net dies") {
   auto [net, priority, m0] = PetriTestNet();
   auto threadpool = std::make_shared<TaskSystem>(1);
   Petri m(net, priority, m0, {}, "s", threadpool);
-  m.net.registerCallback("t0", &petri0);
-  m.net.registerCallback("t1", &petri1);
+  m.registerCallback("t0", &petri0);
+  m.registerCallback("t1", &petri1);
 
-  Reducer r;
   Callback a([] {});
-  // we need to enqueue one 'no-operation' to start the live net.
-  m.reducer_queue->enqueue([](Petri&) {});
+  // we need to send one 'no-operation' to start the live net.
+  m.mailbox->send([](Petri&) {});
   do {
-    if (m.reducer_queue->try_dequeue(r)) {
-      r(m);
+    if (m.mailbox->receive(m, 0, 1) > 0) {
       m.fireTransitions();
     }
   } while (m.scheduled_callbacks.size() > 0);
@@ -132,12 +130,10 @@ TEST_CASE("Run until net dies with DirectMutations") {
   auto threadpool = std::make_shared<TaskSystem>(1);
   Petri m(net, priority, m0, {}, "s", threadpool);
 
-  Reducer r;
-  // we need to enqueue one 'no-operation' to start the live net.
-  m.reducer_queue->enqueue([](Petri&) {});
+  // we need to send one 'no-operation' to start the live net.
+  m.mailbox->send([](Petri&) {});
   do {
-    if (m.reducer_queue->try_dequeue(r)) {
-      r(m);
+    if (m.mailbox->receive(m, 0, 1) > 0) {
       m.fireTransitions();
     }
   } while (m.scheduled_callbacks.size() > 0);
@@ -163,7 +159,7 @@ TEST_CASE("Step through transitions") {
     Petri m(net, {}, m0, {}, "s", threadpool);
     for (const auto& [t, dm] : net) {
       hitmap.insert({t, 0});
-      m.net.registerCallback(t, [&, t = t] { hitmap[t] += 1; });
+      m.registerCallback(t, [&, t = t] { hitmap[t] += 1; });
     }
 
     // auto scheduled_callbacks = m.getActiveTransitions();
@@ -181,13 +177,10 @@ TEST_CASE("Step through transitions") {
     // scheduled_callbacks = m.getActiveTransitions();
     // CHECK(scheduled_callbacks.size() == 0);
     int j = 0;
-    Reducer r;
-    while (j < 2 * 4 &&
-           m.reducer_queue->wait_dequeue_timed(r, std::chrono::seconds(1))) {
+    while (j < 4 && m.mailbox->receive(m, 1000000, 1) > 0) {
       j++;
-      r(m);
     }
-    // reducers update, there should be active transitions left.
+    // completions update, there should be active transitions left.
     CHECK(m.scheduled_callbacks.size() == 0);
   }
 
@@ -199,8 +192,163 @@ TEST_CASE("Step through transitions") {
   CHECK(hitmap.at("e") == 0);
 }
 
+TEST_CASE("A stepped transition waits for its delay") {
+  Net net = {{"t", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, {}, {{"Pa", Success}}, {}, "s", threadpool);
+  std::atomic<bool> is_fired(false);
+  m.registerCallback("t", [&] { is_fired.store(true); });
+  m.setDelay("t", std::chrono::milliseconds(50));
+  m.tryFire("t");
+  // the token is consumed right away, the Callback only starts after the
+  // delay.
+  CHECK(m.getMarking().empty());
+  CHECK(m.scheduled_callbacks.size() == 1);
+  CHECK(m.expireTimers(Clock::now()) == 0);
+  CHECK(!is_fired.load());
+  CHECK(m.expireTimers(Clock::now() + std::chrono::milliseconds(100)) == 1);
+  CHECK(m.mailbox->receive(m, 1000000, 1) == 1);
+  CHECK(is_fired.load());
+  CHECK(m.getMarking() == Marking{{"Pb", Success}});
+}
+
+TEST_CASE("Enabled transitions follow the marking") {
+  Net net = {{"t0", {{{"Pa", Success}, {"Pa", Success}}, {{"Pb", Success}}}},
+             {"t1", {{{"Pa", Success}, {"Pb", Success}}, {}}},
+             {"t2", {{}, {{"Pa", Success}}}}};
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, {}, {}, {}, "s", threadpool);
+  const auto t0 = toIndex(m.net.transition, "t0");
+  const auto t1 = toIndex(m.net.transition, "t1");
+  const auto pa = toIndex(m.net.place, "Pa");
+  const auto pb = toIndex(m.net.place, "Pb");
+  // transitions without inputs are never enabled.
+  CHECK(m.enabled_transitions.empty());
+
+  m.produce(pa, Success);
+  CHECK(m.enabled_transitions.empty());
+  CHECK(m.unsatisfied_inputs[t0] == 1);
+  m.produce(pa, Success);
+  CHECK(m.enabled_transitions.size() == 1);
+  CHECK(m.enabled_transitions.top() == t0);
+  m.produce(pb, Success);
+  CHECK(m.enabled_transitions.size() == 2);
+
+  // consuming the inputs of t0 disables both transitions, as they compete for
+  // the tokens in Pa.
+  m.consume(t0);
+  CHECK(m.unsatisfied_inputs[t0] == 1);
+  CHECK(m.unsatisfied_inputs[t1] == 1);
+  CHECK(m.enabled_transitions.empty());
+
+  // tokens of a different color do not enable anything.
+  m.produce(pa, Failed);
+  CHECK(m.enabled_transitions.empty());
+}
+
+TEST_CASE("Arcs with a weight are merged and consume multiple tokens") {
+  // duplicated arcs and arcs with a weight are equivalent.
+  Net net = {
+      {"t0", {{{"Pa", Success}, {"Pa", Success, 2}}, {{"Pb", Success, 3}}}}};
+  Marking m0(3, {"Pa", Success});
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, {}, m0, {}, "s", threadpool);
+  const auto t0 = toIndex(m.net.transition, "t0");
+  REQUIRE(m.net.input_n[t0].size() == 1);
+  CHECK(m.net.input_n[t0][0].weight == 3);
+
+  m.fireTransitions();
+  Marking expected(3, {"Pb", Success});
+  CHECK(MarkingEquality(m.getMarking(), expected));
+}
+
+TEST_CASE("Arcs with a weight of 0 are rejected") {
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  const Net input = {{"t0", {{{"Pa", Success, 0}}, {{"Pb", Success}}}}};
+  CHECK_THROWS_AS(Petri(input, {}, {}, {}, "s", threadpool),
+                  std::runtime_error);
+  const Net output = {{"t0", {{{"Pa", Success}}, {{"Pb", Success, 0}}}}};
+  CHECK_THROWS_AS(Petri(output, {}, {}, {}, "s", threadpool),
+                  std::runtime_error);
+}
+
+TEST_CASE("Places and transitions are looked up by name") {
+  // t0 consumes two colors from Pa, but is only listed once for Pa.
+  Net net = {{"t0", {{{"Pa", Success}, {"Pa", Failed}}, {{"Pb", Success}}}},
+             {"t1", {{{"Pb", Success}}, {{"Pa", Success}}}}};
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, {}, {}, {}, "s", threadpool);
+  for (size_t i = 0; i < m.net.place.size(); i++) {
+    CHECK(toIndex(m.net.place_index, m.net.place[i]) == i);
+  }
+  for (size_t i = 0; i < m.net.transition.size(); i++) {
+    CHECK(toIndex(m.net.transition_index, m.net.transition[i]) == i);
+  }
+  CHECK(toIndex(m.net.place_index, "Pz") == m.net.place.size());
+
+  const auto pa = toIndex(m.net.place_index, "Pa");
+  const auto t0 = toIndex(m.net.transition_index, "t0");
+  REQUIRE(m.net.p_to_ts_n[pa].size() == 1);
+  CHECK(m.net.p_to_ts_n[pa][0] == t0);
+}
+
+TEST_CASE("The goal marking is tracked while tokens move") {
+  Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  Marking m0(3, {"Pa", Success});
+  Marking goal(2, {"Pb", Success});
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, {}, m0, goal, "s", threadpool);
+  CHECK(!m.goalReached());
+
+  // the goal is only reached if the token count matches exactly.
+  for (const bool reached : {false, true, false}) {
+    m.tryFire("t0");
+    CHECK(m.goalReached() == reached);
+    CHECK(MarkingReached(m.tokens, m.net.final_marking) == reached);
+  }
+
+  // resetting the marking also resets the goal.
+  m.setTokens(m.net.toTokens(goal));
+  CHECK(m.goalReached());
+}
+
+TEST_CASE("An empty goal marking is never reached") {
+  Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}}};
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, {}, {}, {}, "s", threadpool);
+  CHECK(!m.goalReached());
+  CHECK(!MarkingReached(m.tokens, m.net.final_marking));
+}
+
 TEST_CASE("create fireable transitions shortlist") {
   auto [net, priority, m0] = PetriTestNet();
   auto threadpool = std::make_shared<TaskSystem>(1);
   Petri m(net, priority, m0, {}, "s", threadpool);
 }
+
+TEST_CASE("Clearing the mailbox discards pending messages") {
+  auto [net, priority, m0] = PetriTestNet();
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, priority, m0, {}, "s", threadpool);
+  bool reduced = false;
+  m.mailbox->send([&](Petri&) { reduced = true; });
+  m.mailbox->send(runCallback(0, Callback([] {})));
+  m.mailbox->clear();
+  CHECK(m.mailbox->receive(m, 0) == 0);
+  CHECK(!reduced);
+}
+
+TEST_CASE("Receiving times out with every wait policy") {
+  auto [net, priority, m0] = PetriTestNet();
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  Petri m(net, priority, m0, {}, "s", threadpool);
+  for (const auto wait_policy : {WaitPolicy::block(), WaitPolicy::spin(100),
+                                 WaitPolicy::busyPoll()}) {
+    m.wait_policy = wait_policy;
+    const auto begin = Clock::now();
+    CHECK(m.mailbox->receive(m, 1000) == 0);
+    CHECK(Clock::now() - begin >= std::chrono::microseconds(1000));
+    m.mailbox->send([](Petri&) {});
+    CHECK(m.mailbox->receive(m, 1000) == 1);
+  }
+}
@@ -1,3 +1,5 @@
+#include <stdexcept>
+
 #include "doctest/doctest.h"
 #include "petri.h"
 #include "symmetri/utilities.hpp"
@@ -6,16 +8,41 @@ using namespace symmetri;
 
 TEST_CASE("can fire") {
   // place 1 with color 1
-  SmallVectorInput pre_conditions = {{1, Success}};
-  std::vector<AugmentedToken> can_fire_marking = {{1, Success}};
+  std::vector<SmallArc> pre_conditions = {{1, 1, Success}};
+  TokenCounts can_fire_marking(2);
+  produceTokens(can_fire_marking, 1, Success);
   CHECK(canFire(pre_conditions, can_fire_marking));
 
   // wrong token type
-  std::vector<AugmentedToken> can_not_fire_marking = {{1, Token("bla")}};
+  TokenCounts can_not_fire_marking(2);
+  produceTokens(can_not_fire_marking, 1, Token("bla"));
   CHECK(!canFire(pre_conditions, can_not_fire_marking));
 
   // no tokens type
-  CHECK(!canFire(pre_conditions, {}));
+  CHECK(!canFire(pre_conditions, TokenCounts(2)));
+}
+
+TEST_CASE("can fire with multiple tokens of the same color") {
+  // a single arc with weight 2
+  std::vector<SmallArc> pre_conditions = {{0, 2, Success}};
+  TokenCounts marking(1);
+  produceTokens(marking, 0, Success);
+  CHECK(!canFire(pre_conditions, marking));
+  produceTokens(marking, 0, Success);
+  CHECK(canFire(pre_conditions, marking));
+  deductMarking(marking, pre_conditions);
+  CHECK(countTokens(marking, 0, Success) == 0);
+}
+
+TEST_CASE("tokens that are not there can not be deducted") {
+  std::vector<SmallArc> pre_conditions = {{0, 2, Success}};
+  TokenCounts marking(1);
+  // a missing color.
+  CHECK_THROWS_AS(deductMarking(marking, pre_conditions), std::runtime_error);
+  // too few tokens of the color.
+  produceTokens(marking, 0, Success);
+  CHECK_THROWS_AS(deductMarking(marking, pre_conditions), std::runtime_error);
+  CHECK(countTokens(marking, 0, Success) == 1);
 }
 
 TEST_CASE("transitions with no inputs can not fire") {
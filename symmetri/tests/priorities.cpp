@@ -19,14 +19,11 @@ TEST_CASE(
     auto threadpool = std::make_shared<TaskSystem>(1);
 
     auto m = Petri(net, priority, m0, {}, "s", threadpool);
-    m.net.registerCallback("t0", [] {});
-    m.net.registerCallback("t1", [] {});
+    m.registerCallback("t0", [] {});
+    m.registerCallback("t1", [] {});
     m.fireTransitions();
-    Reducer r;
 
-    while (
-        m.reducer_queue->wait_dequeue_timed(r, std::chrono::milliseconds(1))) {
-      r(m);
+    while (m.mailbox->receive(m, 1000) > 0) {
     }
 
     auto prio_t0 = std::find_if(priority.begin(), priority.end(), [](auto e) {
@@ -73,3 +70,35 @@ TEST_CASE("Using DirectMutation does not queue reducers.") {
     }
   }
 }
+
+TEST_CASE("The ready queue returns the enabled transition with the highest "
+          "priority") {
+  // transitions 0..4 with mixed priorities, including the extremes.
+  const std::vector<int8_t> priority = {0, 5, -128, 127, 5};
+  ReadyQueue ready(priority);
+  CHECK(ready.empty());
+
+  ready.insert(0);
+  ready.insert(2);
+  CHECK(ready.top() == 0);
+  ready.insert(1);
+  ready.insert(4);
+  CHECK(ready.size() == 4);
+  CHECK((ready.top() == 1 || ready.top() == 4));
+  ready.insert(3);
+  CHECK(ready.top() == 3);
+
+  ready.erase(3);
+  ready.erase(4);
+  CHECK(ready.top() == 1);
+  ready.erase(1);
+  CHECK(ready.top() == 0);
+  ready.erase(0);
+  CHECK(ready.top() == 2);
+  ready.erase(2);
+  CHECK(ready.empty());
+
+  ready.insert(4);
+  ready.clear();
+  CHECK(ready.empty());
+}
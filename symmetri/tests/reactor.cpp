@@ -0,0 +1,157 @@
+#include "symmetri/reactor.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "doctest/doctest.h"
+
+using namespace symmetri;
+
+namespace {
+
+// collects the results of the handlers, so a test can wait for them.
+class Results {
+ public:
+  Reactor::Handler handler() {
+    return [this](Token result) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      results_.push_back(result);
+      cv_.notify_all();
+    };
+  }
+
+  std::vector<Token> wait(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return results_.size() >= count; });
+    return results_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Token> results_;
+};
+
+// a chain of transitions from Pa to Pd.
+std::shared_ptr<const Topology> chainTopology() {
+  Net net = {{"t0", {{{"Pa", Success}}, {{"Pb", Success}}}},
+             {"t1", {{{"Pb", Success}}, {{"Pc", Success}}}},
+             {"t2", {{{"Pc", Success}}, {{"Pd", Success}}}}};
+  return createTopology(net, {{"Pa", Success}}, {{"Pd", Success}});
+}
+
+// a transition that fires forever, until the net is canceled.
+std::shared_ptr<const Topology> loopTopology() {
+  Net net = {{"t", {{{"Pa", Success}}, {{"Pa", Success}}}}};
+  return createTopology(net, {{"Pa", Success}}, {{"Pb", Success}});
+}
+
+}  // namespace
+
+TEST_CASE("A single thread drives many nets to their goal.") {
+  const auto topology = chainTopology();
+  auto pool = std::make_shared<TaskSystem>(2);
+  std::vector<PetriNet> nets;
+  const size_t count = 500;
+  for (size_t i = 0; i < count; i++) {
+    nets.emplace_back(topology, "case_" + std::to_string(i), pool);
+    nets.back().registerCallback("t1", [] {});
+  }
+
+  Results results;
+  Reactor reactor(1);
+  for (const auto &net : nets) {
+    reactor.fire(net, results.handler());
+  }
+  for (const auto result : results.wait(count)) {
+    CHECK(result == Success);
+  }
+  // the nets are fired exactly like by fire.
+  PetriNet reference(topology, "reference", pool);
+  reference.registerCallback("t1", [] {});
+  CHECK(fire(reference) == Success);
+  for (const auto &net : nets) {
+    CHECK(getLog(net).size() == getLog(reference).size());
+  }
+}
+
+TEST_CASE("A net that is already fired fails.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  PetriNet net(loopTopology(), "loop", pool);
+  net.registerCallback("t", [] {});
+  Results results;
+  Reactor reactor(2);
+  reactor.fire(net, results.handler());
+  reactor.fire(net, results.handler());
+  CHECK(results.wait(1) == std::vector<Token>{Failed});
+  CHECK(reactor.size() == 1);
+  cancel(net);
+  CHECK(results.wait(2) == std::vector<Token>{Failed, Canceled});
+  // the net is forgotten right after its handler returned.
+  while (reactor.size() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+TEST_CASE("A handler can fire its net again.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  PetriNet net(chainTopology(), "again_0", pool);
+  Results results;
+  Reactor reactor;
+  Token first = Scheduled;
+  reactor.fire(net, [&](Token result) {
+    first = result;
+    net.reuseApplication("again_1");
+    reactor.fire(net, results.handler());
+  });
+  CHECK(results.wait(1) == std::vector<Token>{Success});
+  CHECK(first == Success);
+  CHECK(getLog(net).front().case_id == "again_1");
+}
+
+TEST_CASE("Destroying a reactor cancels the nets that are fired.") {
+  auto pool = std::make_shared<TaskSystem>(2);
+  const auto topology = loopTopology();
+  PetriNet a(topology, "a", pool), b(topology, "b", pool);
+  a.registerCallback("t", [] {});
+  b.registerCallback("t", [] {});
+  Results results;
+  {
+    Reactor reactor(2);
+    reactor.fire(a, results.handler());
+    reactor.fire(b, results.handler());
+  }
+  CHECK(results.wait(2) == std::vector<Token>{Canceled, Canceled});
+  // the nets are no longer fired.
+  CHECK(a.reuseApplication("a_1"));
+  CHECK(b.reuseApplication("b_1"));
+}
+
+TEST_CASE("A net that is fired asynchronously can be controlled.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  PetriNet net(loopTopology(), "async", pool);
+  net.registerCallback("t", [] {});
+  Reactor reactor;
+  auto result = fireAsync(net, reactor);
+  CHECK(fireAsync(net, reactor).get() == Failed);
+
+  pause(net);
+  // the pause is applied once the log is returned, as the messages of a net
+  // are handled in order.
+  const auto paused_size = getLog(net).size();
+  CHECK(getLog(net).size() <= paused_size + 3);
+  CHECK(net.getMarking().size() <= 1);
+  resume(net);
+  while (getLog(net).size() < paused_size + 30) {
+    std::this_thread::yield();
+  }
+  CHECK(result.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::timeout);
+  cancel(net);
+  CHECK(result.get() == Canceled);
+  // the firing stops once the net is canceled.
+  const auto canceled_size = getLog(net).size();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  CHECK(getLog(net).size() == canceled_size);
+}
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <thread>
+
+#include "doctest/doctest.h"
+#include "symmetri/reactor.h"
+#include "symmetri/symmetri.h"
+
+using namespace symmetri;
+
+namespace {
+
+// occupies the only thread of a pool until it is released.
+class Blocker {
+ public:
+  explicit Blocker(const TaskSystem &pool) {
+    pool.push([this] {
+      is_blocking_.store(true);
+      while (!is_released_.load()) {
+        std::this_thread::yield();
+      }
+    });
+    while (!is_blocking_.load()) {
+      std::this_thread::yield();
+    }
+  }
+  ~Blocker() { release(); }
+  void release() { is_released_.store(true); }
+
+ private:
+  std::atomic<bool> is_blocking_{false};
+  std::atomic<bool> is_released_{false};
+};
+
+// a transition that fires once for every token in Pa.
+PetriNet parallelNet(const std::shared_ptr<TaskSystem> &pool, size_t count,
+                     std::atomic<size_t> &runs) {
+  PetriNet net({{"t", {{{"Pa", Success}}, {{"Pb", Success}}}}}, "revoke", pool,
+               Marking(count, {"Pa", Success}),
+               Marking(count, {"Pb", Success}));
+  net.registerCallback("t", [&runs] { runs++; });
+  return net;
+}
+
+size_t countEvents(const Eventlog &log, const Token &state) {
+  return std::count_if(log.begin(), log.end(),
+                       [&](const auto &event) { return event.state == state; });
+}
+
+// waits until all firings of the net are scheduled.
+void waitForScheduled(const PetriNet &net, size_t count) {
+  while (countEvents(getLog(net), Scheduled) < count) {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Canceling a net revokes its tasks that did not start.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  std::atomic<size_t> runs{0};
+  const size_t count = 100;
+  auto net = parallelNet(pool, count, runs);
+  Blocker blocker(*pool);
+  Reactor reactor;
+  auto result = fireAsync(net, reactor);
+  waitForScheduled(net, count);
+  cancel(net);
+  // the tasks are revoked once the scheduled runs are logged as canceled.
+  while (countEvents(getLog(net), Canceled) < count) {
+    std::this_thread::yield();
+  }
+  blocker.release();
+  CHECK(result.get() == Canceled);
+  CHECK(runs.load() == 0);
+  const auto log = getLog(net);
+  CHECK(countEvents(log, Started) == 0);
+  // every run is logged once, when it is canceled.
+  CHECK(countEvents(log, Canceled) == count);
+}
+
+TEST_CASE("Pausing a net holds its tasks back until it is resumed.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  std::atomic<size_t> runs{0};
+  const size_t count = 100;
+  auto net = parallelNet(pool, count, runs);
+  Blocker blocker(*pool);
+  Reactor reactor;
+  auto result = fireAsync(net, reactor);
+  waitForScheduled(net, count);
+  pause(net);
+  getLog(net);  // the pause is applied once the log is returned.
+  blocker.release();
+  while (countEvents(getLog(net), Paused) < count) {
+    std::this_thread::yield();
+  }
+  CHECK(runs.load() == 0);
+  resume(net);
+  CHECK(result.get() == Success);
+  CHECK(runs.load() == count);
+  const auto log = getLog(net);
+  CHECK(countEvents(log, Scheduled) == 2 * count);
+  CHECK(countEvents(log, Success) == count);
+}
+
+TEST_CASE("A task that started is not revoked.") {
+  auto pool = std::make_shared<TaskSystem>(1);
+  std::atomic<bool> is_started{false}, is_released{false};
+  PetriNet net({{"t", {{{"Pa", Success}}, {{"Pb", Success}}}}}, "started",
+               pool, {{"Pa", Success}}, {{"Pb", Success}});
+  net.registerCallback("t", [&] {
+    is_started.store(true);
+    while (!is_released.load()) {
+      std::this_thread::yield();
+    }
+  });
+  Reactor reactor;
+  auto result = fireAsync(net, reactor);
+  while (!is_started.load()) {
+    std::this_thread::yield();
+  }
+  pause(net);
+  getLog(net);  // the pause is applied once the log is returned.
+  is_released.store(true);
+  CHECK(result.get() == Success);
+  const auto log = getLog(net);
+  CHECK(countEvents(log, Paused) == 0);
+  CHECK(countEvents(log, Started) == 1);
+}
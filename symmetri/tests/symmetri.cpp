@@ -1,15 +1,29 @@
 #include "symmetri/symmetri.h"
 
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <future>
 #include <iostream>
 
 #include "doctest/doctest.h"
+#include "symmetri/utilities.hpp"
 
 using namespace symmetri;
 
 void t0() {}
 auto t1() {}
 
+// a synchronous Callback, so it runs on the thread that fires the net.
+struct RecordAffinity {
+  std::vector<unsigned> *affinity;
+};
+bool isSynchronous(const RecordAffinity &) { return true; }
+Token fire(const RecordAffinity &callback) {
+  *callback.affinity = availableCpus();
+  return Success;
+}
+
 std::tuple<Net, PriorityTable, Marking> SymmetriTestNet() {
   Net net = {{"t0", {{{"Pa", Success}, {"Pb", Success}}, {{"Pc", Success}}}},
              {"t1",
@@ -57,6 +71,103 @@ TEST_CASE("Create a using the net constructor with end condition.") {
   CHECK(!ev.empty());
 }
 
+TEST_CASE("A net reaches its goal with every wait policy.") {
+  auto [net, priority, initial_marking] = SymmetriTestNet();
+  Marking goal_marking(
+      {{"Pb", Success}, {"Pb", Success}, {"Pd", Success}, {"Pd", Success}});
+  for (const auto wait_policy : {WaitPolicy::block(), WaitPolicy::spin(100),
+                                 WaitPolicy::busyPoll()}) {
+    auto threadpool = std::make_shared<TaskSystem>(
+        2, TaskSystem::Scheduler::WorkStealing, wait_policy);
+    PetriNet app(net, "test_net_wait_policy", threadpool, initial_marking,
+                 goal_marking, priority);
+    app.setWaitPolicy(wait_policy);
+    app.registerCallback("t0", &t0);
+    app.registerCallback("t1", &t1);
+    CHECK(fire(app) == Success);
+  }
+}
+
+TEST_CASE("The firing thread can be pinned to CPUs.") {
+  auto [net, priority, initial_marking] = SymmetriTestNet();
+  const auto cpus = availableCpus();
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  PetriNet app(net, "test_net_fire_affinity", threadpool, initial_marking, {},
+               priority);
+  std::vector<unsigned> affinity;
+  app.registerCallback("t0", RecordAffinity{&affinity});
+  // while the net is fired, the call is ignored without checking the CPUs.
+  std::atomic<bool> is_ignored(false);
+  app.registerCallback("t1", [&] {
+    try {
+      app.setFireAffinity({1u << 20});
+      is_ignored = true;
+    } catch (const std::runtime_error &) {
+    }
+  });
+  CHECK_THROWS_AS(app.setFireAffinity({1u << 20}), std::runtime_error);
+  app.setFireAffinity({cpus.back()});
+  fire(app);
+  CHECK(affinity == std::vector<unsigned>{cpus.back()});
+  CHECK(is_ignored);
+  // the affinity is restored afterwards.
+  CHECK(availableCpus() == cpus);
+}
+
+TEST_CASE("PetriNets can share a topology.") {
+  auto threadpool = std::make_shared<TaskSystem>(1);
+  auto [net, priority, initial_marking] = SymmetriTestNet();
+  Marking goal_marking(
+      {{"Pb", Success}, {"Pb", Success}, {"Pd", Success}, {"Pd", Success}});
+  const auto topology =
+      createTopology(net, initial_marking, goal_marking, priority);
+  PetriNet a(topology, "case_a", threadpool);
+  PetriNet b(topology, "case_b", threadpool);
+  // callbacks are registered per case.
+  a.registerCallback("t0", &t0);
+  a.registerCallback("t1", &t1);
+  b.registerCallback("t0", [] { return Failed; });
+
+  CHECK(fire(a) == Success);
+  CHECK(fire(b) == Deadlocked);
+  CHECK(MarkingEquality(a.getMarking(), goal_marking));
+  CHECK(MarkingEquality(b.getMarking(), initial_marking) == false);
+  for (const auto &event : getLog(b)) {
+    CHECK(event.case_id == "case_b");
+  }
+}
+
+TEST_CASE("PetriNets share a FairShare TaskSystem by weight.") {
+  auto threadpool =
+      std::make_shared<TaskSystem>(2, TaskSystem::Scheduler::FairShare);
+  auto [net, priority, initial_marking] = SymmetriTestNet();
+  Marking goal_marking(
+      {{"Pb", Success}, {"Pb", Success}, {"Pd", Success}, {"Pd", Success}});
+  const auto topology =
+      createTopology(net, initial_marking, goal_marking, priority);
+  PetriNet a(topology, "case_a", threadpool);
+  PetriNet b(topology, "case_b", threadpool);
+  a.setShareWeight(3);
+  for (const auto &app : {a, b}) {
+    app.registerCallback("t0", &t0);
+    app.registerCallback("t1", &t1);
+  }
+  auto result_b = std::async(std::launch::async, [&] { return fire(b); });
+  CHECK(fire(a) == Success);
+  CHECK(result_b.get() == Success);
+  // every Callback was queued on the TaskSystem and started.
+  for (const auto &app : {a, b}) {
+    const auto log = getLog(app);
+    const auto stats = app.getQueueStats();
+    CHECK(stats.queued == 0);
+    CHECK(stats.peak >= 1);
+    CHECK(stats.started == static_cast<uint64_t>(std::count_if(
+                               log.begin(), log.end(), [](const auto &e) {
+                                 return e.state == Started;
+                               })));
+  }
+}
+
 TEST_CASE("Create a using pnml constructor.") {
   const std::string pnml_file = std::filesystem::current_path().append(
       "../../../symmetri/tests/assets/PT1.pnml");
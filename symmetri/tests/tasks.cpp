@@ -0,0 +1,387 @@
+#include "symmetri/tasks.h"
+
+#include <algorithm>
+#include <array>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "doctest/doctest.h"
+
+using namespace symmetri;
+
+namespace {
+
+const std::vector<TaskSystem::Scheduler> schedulers = {
+    TaskSystem::Scheduler::SharedQueue, TaskSystem::Scheduler::WorkStealing,
+    TaskSystem::Scheduler::FairShare};
+
+// blocks until count tasks called done.
+class Latch {
+ public:
+  explicit Latch(size_t count) : count_(count) {}
+  void done() {
+    if (count_.fetch_sub(1) == 1) {
+      promise_.set_value();
+    }
+  }
+  bool wait() {
+    return promise_.get_future().wait_for(std::chrono::seconds(5)) ==
+           std::future_status::ready;
+  }
+
+ private:
+  std::atomic<size_t> count_;
+  std::promise<void> promise_;
+};
+
+}  // namespace
+
+TEST_CASE("All pushed tasks are executed") {
+  for (const auto scheduler : schedulers) {
+    for (const auto wait_policy : {WaitPolicy::block(), WaitPolicy::spin(100),
+                                   WaitPolicy::busyPoll()}) {
+      const size_t task_count = 10000;
+      std::atomic<size_t> executed(0);
+      Latch latch(task_count);
+      auto pool = std::make_shared<TaskSystem>(2, scheduler, wait_policy);
+      for (size_t i = 0; i < task_count; i++) {
+        pool->push([&] {
+          executed++;
+          latch.done();
+        });
+      }
+      CHECK(latch.wait());
+      CHECK(executed.load() == task_count);
+    }
+  }
+}
+
+TEST_CASE("Tasks that are pushed from tasks are executed") {
+  for (const auto scheduler : schedulers) {
+    const size_t task_count = 100;
+    Latch latch(task_count * task_count);
+    auto pool = std::make_shared<TaskSystem>(4, scheduler);
+    for (size_t i = 0; i < task_count; i++) {
+      pool->push([&] {
+        for (size_t j = 0; j < task_count; j++) {
+          pool->push([&] { latch.done(); });
+        }
+      });
+    }
+    CHECK(latch.wait());
+  }
+}
+
+TEST_CASE("All tasks that are pushed in bulk are executed") {
+  for (const auto scheduler : schedulers) {
+    const size_t batch_count = 100;
+    const size_t batch_size = 37;
+    Latch latch(2 * batch_count * batch_size);
+    auto pool = std::make_shared<TaskSystem>(4, scheduler);
+    const auto push_batch = [&] {
+      std::vector<TaskSystem::Task> batch;
+      for (size_t j = 0; j < batch_size; j++) {
+        batch.emplace_back([&] { latch.done(); });
+      }
+      pool->pushBulk(batch.data(), batch.size());
+    };
+    for (size_t i = 0; i < batch_count; i++) {
+      // from this thread and from a thread of the pool.
+      push_batch();
+      pool->push(push_batch);
+    }
+    CHECK(latch.wait());
+  }
+}
+
+// runs the tasks that are pushed while the only worker of the pool is blocked,
+// and returns the priorities in the order in which the tasks were executed.
+std::vector<int> executionOrder(const std::shared_ptr<TaskSystem> &pool,
+                                const std::vector<int> &priorities) {
+  std::promise<void> gate;
+  auto is_open = gate.get_future().share();
+  Latch is_blocked(1);
+  pool->push([&, is_open] {
+    is_blocked.done();
+    is_open.wait();
+  });
+  REQUIRE(is_blocked.wait());
+  std::vector<int> order;
+  Latch latch(priorities.size());
+  for (const auto priority : priorities) {
+    pool->push(
+        [&, priority] {
+          order.push_back(priority);
+          latch.done();
+        },
+        priority);
+  }
+  gate.set_value();
+  CHECK(latch.wait());
+  return order;
+}
+
+TEST_CASE("Tasks with a higher priority are executed first") {
+  for (const auto scheduler : {TaskSystem::Scheduler::SharedQueue,
+                               TaskSystem::Scheduler::WorkStealing}) {
+    CHECK(executionOrder(std::make_shared<TaskSystem>(1, scheduler),
+                         {0, 2, 1, -1, 2}) == std::vector<int>{2, 2, 1, 0, -1});
+  }
+  // priorities beyond the range of int8_t are clamped.
+  CHECK(executionOrder(std::make_shared<TaskSystem>(1), {200, 0, -200}) ==
+        std::vector<int>{200, 0, -200});
+}
+
+TEST_CASE("The default TaskSystem executes tasks by priority") {
+  CHECK(executionOrder(std::make_shared<TaskSystem>(1), {-1, 0, 1}) ==
+        std::vector<int>{1, 0, -1});
+}
+
+TEST_CASE("Tasks with a low priority are not starved") {
+  // one low priority task that waits behind many high priority tasks is
+  // executed after a bounded amount of them.
+  std::vector<int> priorities = {0};
+  priorities.insert(priorities.end(), 1000, 1);
+  for (const auto scheduler : {TaskSystem::Scheduler::SharedQueue,
+                               TaskSystem::Scheduler::WorkStealing}) {
+    const auto order =
+        executionOrder(std::make_shared<TaskSystem>(1, scheduler), priorities);
+    const auto position =
+        std::find(order.begin(), order.end(), 0) - order.begin();
+    CHECK(position > 0);
+    CHECK(position < 200);
+  }
+}
+
+// runs the tasks that are pushed for the shares while the only worker of a
+// FairShare pool is blocked, and returns the indices of the shares in the order
+// in which their tasks were executed. pushes[i] is the share of the i-th push.
+std::vector<size_t> shareOrder(
+    const std::vector<std::shared_ptr<Share>> &shares,
+    const std::vector<size_t> &pushes) {
+  auto pool = std::make_shared<TaskSystem>(1, TaskSystem::Scheduler::FairShare);
+  std::promise<void> gate;
+  auto is_open = gate.get_future().share();
+  pool->push([=] { is_open.wait(); });
+  std::vector<size_t> order;
+  Latch latch(pushes.size());
+  for (const auto index : pushes) {
+    pool->push(
+        [&, index] {
+          order.push_back(index);
+          latch.done();
+        },
+        0, shares[index]);
+  }
+  gate.set_value();
+  CHECK(latch.wait());
+  return order;
+}
+
+TEST_CASE("Shares get tasks executed in proportion to their weights") {
+  const std::vector<std::shared_ptr<Share>> shares = {
+      std::make_shared<Share>(2), std::make_shared<Share>(1)};
+  // the first share queues all its tasks before the second one.
+  std::vector<size_t> pushes(300, 0);
+  pushes.insert(pushes.end(), 300, 1);
+  const auto order = shareOrder(shares, pushes);
+  REQUIRE(order.size() == pushes.size());
+  const auto first =
+      std::count(order.begin(), order.begin() + 300, size_t(0));
+  CHECK(first >= 195);
+  CHECK(first <= 205);
+}
+
+TEST_CASE("A share that floods the pool does not starve other shares") {
+  const std::vector<std::shared_ptr<Share>> shares = {
+      std::make_shared<Share>(), std::make_shared<Share>()};
+  std::vector<size_t> pushes(1000, 0);
+  pushes.push_back(1);
+  const auto order = shareOrder(shares, pushes);
+  const auto position =
+      std::find(order.begin(), order.end(), size_t(1)) - order.begin();
+  CHECK(position <= 1);
+}
+
+TEST_CASE("A share counts its queued and started tasks") {
+  auto share = std::make_shared<Share>(0);
+  CHECK(share->weight() == 1);
+  auto pool = std::make_shared<TaskSystem>(1, TaskSystem::Scheduler::FairShare);
+  std::promise<void> gate;
+  auto is_open = gate.get_future().share();
+  Latch is_blocked(1);
+  pool->push([&, is_open] {
+    is_blocked.done();
+    is_open.wait();
+  });
+  REQUIRE(is_blocked.wait());
+  Latch latch(5);
+  std::vector<TaskSystem::Task> batch;
+  for (size_t i = 0; i < 4; i++) {
+    batch.emplace_back([&] { latch.done(); });
+  }
+  pool->pushBulk(batch.data(), batch.size(), 0, share);
+  pool->push([&] { latch.done(); }, 0, share);
+  const auto queued = share->stats();
+  CHECK(queued.queued == 5);
+  CHECK(queued.peak == 5);
+  CHECK(queued.started == 0);
+  gate.set_value();
+  CHECK(latch.wait());
+  const auto done = share->stats();
+  CHECK(done.queued == 0);
+  CHECK(done.peak == 5);
+  CHECK(done.started == 5);
+}
+
+TEST_CASE("Shares that push concurrently get all their tasks executed") {
+  auto pool = std::make_shared<TaskSystem>(4, TaskSystem::Scheduler::FairShare);
+  std::vector<std::shared_ptr<Share>> shares;
+  for (unsigned i = 0; i < 40; i++) {
+    shares.push_back(std::make_shared<Share>(1 + i % 3));
+  }
+  const size_t task_count = 500;
+  Latch latch(shares.size() * task_count);
+  std::vector<std::thread> pushers;
+  for (size_t i = 0; i < 4; i++) {
+    pushers.emplace_back([&, i] {
+      for (size_t j = 0; j < task_count; j++) {
+        for (size_t k = i; k < shares.size(); k += 4) {
+          pool->push([&] { latch.done(); }, static_cast<int>(j % 2), shares[k]);
+        }
+      }
+    });
+  }
+  for (auto &pusher : pushers) {
+    pusher.join();
+  }
+  CHECK(latch.wait());
+  for (const auto &share : shares) {
+    CHECK(share->stats().started == task_count);
+  }
+}
+
+TEST_CASE("A task that is pushed from a blocked worker is stolen") {
+  // the nested task is queued on the worker that is blocked on it, so it can
+  // only be executed by another worker.
+  std::promise<void> nested;
+  auto is_nested_done = nested.get_future();
+  std::promise<bool> outer;
+  auto pool =
+      std::make_shared<TaskSystem>(2, TaskSystem::Scheduler::WorkStealing);
+  pool->push([&] {
+    pool->push([&] { nested.set_value(); });
+    outer.set_value(is_nested_done.wait_for(std::chrono::seconds(5)) ==
+                    std::future_status::ready);
+  });
+  CHECK(outer.get_future().get());
+}
+
+TEST_CASE("Parked workers wake up for new tasks") {
+  auto pool =
+      std::make_shared<TaskSystem>(2, TaskSystem::Scheduler::WorkStealing);
+  for (int i = 0; i < 3; i++) {
+    // give the workers time to park.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    Latch latch(2);
+    pool->push([&] { latch.done(); });
+    pool->push([&] { latch.done(); });
+    CHECK(latch.wait());
+  }
+}
+
+TEST_CASE("An InlineTask can hold move-only callables") {
+  auto value = std::make_unique<int>(0);
+  auto raw = value.get();
+  TaskSystem::Task task = [value = std::move(value)] { (*value)++; };
+  TaskSystem::Task moved = std::move(task);
+  CHECK(!task);
+  REQUIRE(moved);
+  moved();
+  moved();
+  CHECK(*raw == 2);
+}
+
+TEST_CASE("An InlineTask destroys its callable exactly once") {
+  // the large capture does not fit inline, so it is stored on the heap.
+  std::array<char, 2 * TaskSystem::Task::capacity> large{};
+  for (const bool is_large : {false, true}) {
+    auto counter = std::make_shared<int>(0);
+    {
+      TaskSystem::Task task;
+      if (is_large) {
+        task = [counter, large] { (*counter) += large.size(); };
+      } else {
+        task = [counter] { (*counter)++; };
+      }
+      CHECK(counter.use_count() == 2);
+      TaskSystem::Task moved(std::move(task));
+      moved();
+      CHECK(counter.use_count() == 2);
+      moved = nullptr;
+      CHECK(counter.use_count() == 1);
+    }
+    CHECK(counter.use_count() == 1);
+    CHECK(*counter ==
+          static_cast<int>(is_large ? 2 * TaskSystem::Task::capacity : 1));
+  }
+}
+
+TEST_CASE("An InlineFunction passes its arguments and returns the result") {
+  int calls = 0;
+  InlineFunction<int(int, int &), 16> add = [&calls](int a, int &b) {
+    calls++;
+    return a + b++;
+  };
+  int b = 2;
+  CHECK(add(1, b) == 3);
+  CHECK(b == 3);
+  auto moved = std::move(add);
+  CHECK(!add);
+  CHECK(moved(1, b) == 4);
+  CHECK(calls == 2);
+}
+
+TEST_CASE("Threads can be pinned to CPUs") {
+  const auto cpus = availableCpus();
+  REQUIRE(!cpus.empty());
+  for (const auto scheduler : schedulers) {
+    for (const bool numa_aware : {false, true}) {
+      auto pool = std::make_shared<TaskSystem>(
+          2, scheduler, WaitPolicy::block(),
+          Placement{{cpus.back()}, numa_aware});
+      std::promise<std::vector<unsigned>> affinity;
+      pool->push([&] { affinity.set_value(availableCpus()); });
+      CHECK(affinity.get_future().get() ==
+            std::vector<unsigned>{cpus.back()});
+    }
+  }
+  // only the allowed CPUs can be used.
+  CHECK_THROWS_AS(TaskSystem(1, TaskSystem::Scheduler::WorkStealing,
+                             WaitPolicy::block(), Placement{{1u << 20}, false}),
+                  std::runtime_error);
+}
+
+TEST_CASE("A NUMA-aware pool spreads its threads over all CPUs") {
+  const auto cpus = availableCpus();
+  auto pool = std::make_shared<TaskSystem>(
+      cpus.size(), TaskSystem::Scheduler::WorkStealing, WaitPolicy::block(),
+      Placement{{}, true});
+  Latch latch(cpus.size());
+  std::mutex mutex;
+  std::vector<unsigned> used;
+  for (size_t i = 0; i < cpus.size(); i++) {
+    pool->push([&] {
+      const auto affinity = availableCpus();
+      std::lock_guard<std::mutex> lock(mutex);
+      used.insert(used.end(), affinity.begin(), affinity.end());
+      latch.done();
+    });
+  }
+  CHECK(latch.wait());
+  for (const auto cpu : used) {
+    CHECK(std::find(cpus.begin(), cpus.end(), cpu) != cpus.end());
+  }
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+/** @file timer_wheel.h */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "symmetri/types.h"
+
+namespace symmetri {
+
+/**
+ * @brief The resolution of the timers of the nets and the Reactor.
+ *
+ */
+constexpr auto kTimerResolution = std::chrono::microseconds(100);
+
+/**
+ * @brief A hierarchical timer wheel. Time is divided in ticks of a fixed
+ * resolution; a timer is stored in the slot of the level that matches how far
+ * away its deadline is, and is moved to a lower level once its slot comes
+ * within reach. Scheduling a timer and expiring it take constant time, so a
+ * large amount of pending timers only costs memory. Timers can not be
+ * removed: the owner of a timer ignores a timer that is no longer relevant
+ * when it expires. Timers never expire early, but can expire up to one tick
+ * late.
+ *
+ * @tparam T the value that is passed back when a timer expires
+ */
+template <typename T>
+class TimerWheel {
+ public:
+  /**
+   * @brief Construct a new TimerWheel
+   *
+   * @param resolution the duration of a tick
+   * @param origin the time of the first tick
+   */
+  explicit TimerWheel(Clock::duration resolution, Clock::time_point origin)
+      : resolution_(resolution), origin_(origin) {}
+
+  /**
+   * @brief Adds a timer. A deadline in the past expires with the next call to
+   * expire.
+   *
+   * @param deadline
+   * @param value
+   */
+  void schedule(Clock::time_point deadline, T value) {
+    // the deadline is rounded up, so a timer never expires early.
+    const auto ticks = (deadline - origin_ + resolution_ - Clock::duration(1)) /
+                       resolution_;
+    insert({ticks > 0 ? static_cast<uint64_t>(ticks) : 0, std::move(value)});
+    size_++;
+  }
+
+  /**
+   * @brief Expires the timers of which the deadline is not later than now.
+   *
+   * @param now
+   * @param f is called with the value of every expired timer
+   * @return size_t the amount of expired timers
+   */
+  template <typename F>
+  size_t expire(Clock::time_point now, F &&f) {
+    if (now < origin_) {
+      return 0;
+    }
+    const auto target = static_cast<uint64_t>((now - origin_) / resolution_);
+    size_t expired = 0;
+    std::vector<Entry> due;
+    while (tick_ <= target) {
+      if (size_ == 0) {
+        tick_ = target + 1;
+        break;
+      }
+      auto &slot = levels_[0].slots[tick_ & kMask];
+      if (!slot.empty()) {
+        due.swap(slot);
+        levels_[0].clear(tick_ & kMask);
+        size_ -= due.size();
+        expired += due.size();
+        for (auto &entry : due) {
+          f(std::move(entry.value));
+        }
+        due.clear();
+      }
+      // empty slots up to the end of the rotation of the lowest level are
+      // skipped at once. The slot is processed again if f added a timer to it.
+      const auto next = levels_[0].next(tick_ & kMask);
+      tick_ = std::min((tick_ & ~kMask) + next, target + 1);
+      if ((tick_ & kMask) == 0) {
+        cascade();
+      }
+    }
+    return expired;
+  }
+
+  /**
+   * @brief The time at which expire should be called next. For timers that
+   * are not on the lowest level this is the end of the current rotation of
+   * the lowest level, after which they have moved closer.
+   *
+   * @return std::optional<Clock::time_point> nullopt if there are no timers
+   */
+  std::optional<Clock::time_point> nextDeadline() const {
+    if (size_ == 0) {
+      return std::nullopt;
+    }
+    const auto next = levels_[0].next(tick_ & kMask);
+    const auto tick = static_cast<int64_t>((tick_ & ~kMask) + next);
+    return origin_ + resolution_ * tick;
+  }
+
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+ private:
+  static constexpr size_t kBits = 8;
+  static constexpr size_t kSlots = size_t(1) << kBits;
+  static constexpr uint64_t kMask = kSlots - 1;
+  static constexpr size_t kLevels = 4;
+
+  struct Entry {
+    uint64_t deadline;  ///< in ticks
+    T value;
+  };
+
+  struct Level {
+    std::array<std::vector<Entry>, kSlots> slots;
+    std::array<uint64_t, kSlots / 64> is_used = {};  ///< a bit per slot
+
+    void add(size_t slot, Entry &&entry) {
+      slots[slot].push_back(std::move(entry));
+      is_used[slot / 64] |= uint64_t(1) << (slot % 64);
+    }
+
+    void clear(size_t slot) {
+      is_used[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+
+    /**
+     * @brief The first used slot from slot on.
+     *
+     * @return size_t kSlots if there is none
+     */
+    size_t next(size_t slot) const {
+      for (auto word = slot / 64; word < is_used.size(); word++) {
+        const auto bits = word == slot / 64
+                              ? is_used[word] & (~uint64_t(0) << (slot % 64))
+                              : is_used[word];
+        if (bits != 0) {
+          return word * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+        }
+      }
+      return kSlots;
+    }
+  };
+
+  void insert(Entry &&entry) {
+    const auto deadline = std::max(entry.deadline, tick_);
+    const auto delta = deadline - tick_;
+    for (size_t level = 0; level < kLevels; level++) {
+      if (delta < (uint64_t(1) << (kBits * (level + 1)))) {
+        levels_[level].add((deadline >> (kBits * level)) & kMask,
+                           std::move(entry));
+        return;
+      }
+    }
+    overflow_.push_back(std::move(entry));
+  }
+
+  /**
+   * @brief Moves the timers of the slots of the higher levels that came
+   * within reach of a lower level. It is called when the lowest level starts
+   * a new rotation.
+   *
+   */
+  void cascade() {
+    for (size_t level = 1; level <= kLevels; level++) {
+      std::vector<Entry> entries;
+      if (level == kLevels) {
+        entries.swap(overflow_);
+      } else {
+        const auto slot = (tick_ >> (kBits * level)) & kMask;
+        entries.swap(levels_[level].slots[slot]);
+        levels_[level].clear(slot);
+      }
+      for (auto &entry : entries) {
+        insert(std::move(entry));
+      }
+      if (level < kLevels && ((tick_ >> (kBits * level)) & kMask) != 0) {
+        break;
+      }
+    }
+  }
+
+  const Clock::duration resolution_;
+  const Clock::time_point origin_;
+  uint64_t tick_ = 0;  ///< all ticks before this one are expired
+  size_t size_ = 0;
+  std::array<Level, kLevels> levels_;
+  std::vector<Entry> overflow_;  ///< the timers beyond the highest level
+};
+
+}  // namespace symmetri
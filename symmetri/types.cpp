@@ -1,6 +1,7 @@
 #include "symmetri/types.h"
 
 #include <algorithm>
+#include <map>
 #include <numeric>
 
 #include "symmetri/colors.hpp"
@@ -9,33 +10,36 @@ namespace symmetri {
 bool isSynchronous(const DirectMutation&) { return true; }
 Token fire(const DirectMutation&) { return Success; }
 
+bool operator==(const Arc& lhs, const Arc& rhs) {
+  return lhs.place == rhs.place && lhs.color == rhs.color &&
+         lhs.weight == rhs.weight;
+}
+
+/**
+ * @brief Sums the weights of the arcs per colored place, so that an arc with
+ * weight n compares equal to n arcs with weight 1.
+ *
+ * @param arcs
+ * @return std::map<std::pair<Place, size_t>, size_t>
+ */
+std::map<std::pair<Place, size_t>, size_t> arcWeights(
+    const std::vector<Arc>& arcs) {
+  std::map<std::pair<Place, size_t>, size_t> weights;
+  for (const auto& [place, color, weight] : arcs) {
+    weights[{place, color.toIndex()}] += weight;
+  }
+  return weights;
+}
+
 bool stateNetEquality(const Net& net1, const Net& net2) {
   if (net1.size() != net2.size()) {
     return false;
   }
   for (const auto& [t1, mut1] : net1) {
-    if (net2.find(t1) != net2.end()) {
-      for (const auto& pre : mut1.first) {
-        if (mut1.first.size() != net2.at(t1).first.size()) {
-          return false;
-        }
-        if (std::count(std::begin(mut1.first), std::end(mut1.first), pre) !=
-            std::count(std::begin(net2.at(t1).first),
-                       std::end(net2.at(t1).first), pre)) {
-          return false;
-        }
-      }
-      for (const auto& post : mut1.second) {
-        if (mut1.second.size() != net2.at(t1).second.size()) {
-          return false;
-        }
-        if (std::count(std::begin(mut1.second), std::end(mut1.second), post) !=
-            std::count(std::begin(net2.at(t1).second),
-                       std::end(net2.at(t1).second), post)) {
-          return false;
-        }
-      }
-    } else {
+    const auto mut2 = net2.find(t1);
+    if (mut2 == net2.end() ||
+        arcWeights(mut1.first) != arcWeights(mut2->second.first) ||
+        arcWeights(mut1.second) != arcWeights(mut2->second.second)) {
       return false;
     }
   }
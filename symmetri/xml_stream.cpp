@@ -0,0 +1,304 @@
+#include "xml_stream.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace symmetri {
+
+namespace {
+
+constexpr size_t kChunkSize = 1 << 16;
+
+/**
+ * @brief Reads a file one character at a time, while only keeping a single
+ * chunk of the file in memory.
+ *
+ */
+class ChunkedFile {
+ public:
+  explicit ChunkedFile(const std::string &path)
+      : in_(path, std::ios::binary), buffer_(kChunkSize) {
+    if (!in_) {
+      throw std::runtime_error("can not open '" + path + "'");
+    }
+  }
+
+  /**
+   * @brief Reads the next character.
+   *
+   * @return int the character as unsigned char, or EOF
+   */
+  int get() {
+    return (pos_ < end_ || fill()) ? static_cast<unsigned char>(buffer_[pos_++])
+                                   : EOF;
+  }
+
+  /**
+   * @brief Reads the next character and throws if the file ended.
+   *
+   * @return char
+   */
+  char next() {
+    const auto c = get();
+    if (c == EOF) {
+      throw std::runtime_error("unexpected end of xml-file");
+    }
+    return static_cast<char>(c);
+  }
+
+ private:
+  bool fill() {
+    in_.read(buffer_.data(), buffer_.size());
+    pos_ = 0;
+    end_ = static_cast<size_t>(in_.gcount());
+    return end_ > 0;
+  }
+
+  std::ifstream in_;
+  std::vector<char> buffer_;
+  size_t pos_ = 0;
+  size_t end_ = 0;
+};
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+ * @brief Reads until (and including) terminator and returns what was read
+ * before it.
+ *
+ */
+std::string readUntil(ChunkedFile &file, std::string_view terminator) {
+  std::string content;
+  while (content.size() < terminator.size() ||
+         std::string_view(content).substr(content.size() -
+                                          terminator.size()) != terminator) {
+    content.push_back(file.next());
+  }
+  content.resize(content.size() - terminator.size());
+  return content;
+}
+
+void appendUtf8(std::string &out, unsigned long code_point) {
+  if (code_point < 0x80) {
+    out.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+/**
+ * @brief Replaces the character references in s. Unknown references are
+ * kept as they are. It throws a std::runtime_error if a numeric reference
+ * is not a valid code point.
+ *
+ */
+std::string unescape(std::string_view s) {
+  std::string out;
+  out.reserve(s.size());
+  size_t i = 0;
+  while (i < s.size()) {
+    const auto amp = s.find('&', i);
+    const auto semicolon =
+        amp == std::string_view::npos ? amp : s.find(';', amp);
+    if (semicolon == std::string_view::npos) {
+      out.append(s.substr(i));
+      break;
+    }
+    out.append(s.substr(i, amp - i));
+    const auto entity = std::string(s.substr(amp + 1, semicolon - amp - 1));
+    if (entity == "lt") {
+      out.push_back('<');
+    } else if (entity == "gt") {
+      out.push_back('>');
+    } else if (entity == "amp") {
+      out.push_back('&');
+    } else if (entity == "quot") {
+      out.push_back('"');
+    } else if (entity == "apos") {
+      out.push_back('\'');
+    } else if (!entity.empty() && entity[0] == '#') {
+      const bool hex = entity.size() > 1 && entity[1] == 'x';
+      const auto digits = entity.c_str() + (hex ? 2 : 1);
+      char *end = nullptr;
+      const auto code_point =
+          std::isxdigit(static_cast<unsigned char>(*digits))
+              ? std::strtoull(digits, &end, hex ? 16 : 10)
+              : 0;
+      // 0, the UTF-16 surrogates and values beyond unicode are no
+      // characters.
+      if (end != entity.c_str() + entity.size() || code_point == 0 ||
+          (code_point >= 0xD800 && code_point <= 0xDFFF) ||
+          code_point > 0x10FFFF) {
+        throw std::runtime_error("invalid character reference &" + entity +
+                                 ";");
+      }
+      appendUtf8(out, static_cast<unsigned long>(code_point));
+    } else {
+      out.append(s.substr(amp, semicolon - amp + 1));
+    }
+    i = semicolon + 1;
+  }
+  return out;
+}
+
+/**
+ * @brief Splits the content of a start tag into its name and attributes.
+ *
+ * @return true if the tag is self-closing
+ */
+bool parseTag(std::string_view tag, std::string &name,
+              XmlAttributes &attributes) {
+  const auto malformed = [&] {
+    return std::runtime_error("malformed xml-tag <" + std::string(tag) + ">");
+  };
+  size_t i = 0;
+  const auto skip_space = [&] {
+    while (i < tag.size() && isSpace(tag[i])) {
+      i++;
+    }
+  };
+  while (i < tag.size() && !isSpace(tag[i]) && tag[i] != '/') {
+    i++;
+  }
+  name = tag.substr(0, i);
+  attributes.clear();
+  bool self_closing = false;
+  while (skip_space(), i < tag.size()) {
+    if (tag[i] == '/') {
+      self_closing = true;
+      i++;
+      continue;
+    }
+    const auto name_begin = i;
+    while (i < tag.size() && !isSpace(tag[i]) && tag[i] != '=') {
+      i++;
+    }
+    const auto attribute = tag.substr(name_begin, i - name_begin);
+    skip_space();
+    if (i >= tag.size() || tag[i] != '=') {
+      throw malformed();
+    }
+    i++;
+    skip_space();
+    if (i >= tag.size() || (tag[i] != '"' && tag[i] != '\'')) {
+      throw malformed();
+    }
+    const auto end = tag.find(tag[i], i + 1);
+    if (end == std::string_view::npos) {
+      throw malformed();
+    }
+    attributes.emplace_back(attribute,
+                            unescape(tag.substr(i + 1, end - i - 1)));
+    i = end + 1;
+  }
+  if (name.empty()) {
+    throw malformed();
+  }
+  return self_closing;
+}
+
+}  // namespace
+
+const std::string *findAttribute(const XmlAttributes &attributes,
+                                 std::string_view name) {
+  for (const auto &[key, value] : attributes) {
+    if (key == name) {
+      return &value;
+    }
+  }
+  return nullptr;
+}
+
+void parseXml(const std::string &path, XmlHandler &handler) {
+  ChunkedFile file(path);
+  std::vector<std::string> open_elements;
+  std::string text, tag, name;
+  XmlAttributes attributes;
+
+  const auto flush_text = [&] {
+    if (!text.empty()) {
+      handler.text(unescape(text));
+      text.clear();
+    }
+  };
+
+  int c;
+  while ((c = file.get()) != EOF) {
+    if (c != '<') {
+      text.push_back(static_cast<char>(c));
+      continue;
+    }
+    flush_text();
+    c = file.next();
+    if (c == '?') {
+      readUntil(file, "?>");
+    } else if (c == '!') {
+      c = file.next();
+      if (c == '-' && file.next() == '-') {
+        readUntil(file, "-->");
+      } else if (c == '[' && readUntil(file, "[") == "CDATA") {
+        handler.text(readUntil(file, "]]>"));
+      } else {
+        // a doctype declaration, which can contain an internal subset.
+        int depth = c == '[' ? 1 : 0;
+        while ((c = file.next()) != '>' || depth > 0) {
+          depth += c == '[' ? 1 : c == ']' ? -1 : 0;
+        }
+      }
+    } else if (c == '/') {
+      name.clear();
+      while ((c = file.next()) != '>') {
+        name.push_back(static_cast<char>(c));
+      }
+      while (!name.empty() && isSpace(name.back())) {
+        name.pop_back();
+      }
+      if (open_elements.empty() || open_elements.back() != name) {
+        throw std::runtime_error("unexpected closing tag </" + name + ">");
+      }
+      open_elements.pop_back();
+      handler.endElement(name);
+    } else {
+      // read the start tag, a '>' can occur in the values of attributes.
+      tag.assign(1, static_cast<char>(c));
+      char quote = 0;
+      while ((c = file.next()) != '>' || quote != 0) {
+        if (quote == 0 && (c == '"' || c == '\'')) {
+          quote = static_cast<char>(c);
+        } else if (quote == c) {
+          quote = 0;
+        }
+        tag.push_back(static_cast<char>(c));
+      }
+      const bool self_closing = parseTag(tag, name, attributes);
+      handler.startElement(name, attributes);
+      if (self_closing) {
+        handler.endElement(name);
+      } else {
+        open_elements.push_back(name);
+      }
+    }
+  }
+  flush_text();
+  if (!open_elements.empty()) {
+    throw std::runtime_error("unexpected end of xml-file, <" +
+                             open_elements.back() + "> is not closed");
+  }
+}
+
+}  // namespace symmetri
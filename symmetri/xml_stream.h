@@ -0,0 +1,62 @@
+#pragma once
+
+/** @file xml_stream.h */
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace symmetri {
+
+/**
+ * @brief The attributes of an element as (name, value) pairs. The values are
+ * already unescaped.
+ *
+ */
+using XmlAttributes = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief Get the value of an attribute.
+ *
+ * @param attributes
+ * @param name
+ * @return const std::string* nullptr if the element has no such attribute
+ */
+const std::string *findAttribute(const XmlAttributes &attributes,
+                                 std::string_view name);
+
+/**
+ * @brief XmlHandler receives the events of parseXml in document order.
+ *
+ */
+class XmlHandler {
+ public:
+  virtual ~XmlHandler() = default;
+  virtual void startElement(std::string_view name,
+                            const XmlAttributes &attributes) = 0;
+  virtual void endElement(std::string_view name) = 0;
+  /**
+   * @brief Is called for the (unescaped) text between tags. The text of a
+   * single element can be reported in multiple pieces.
+   *
+   */
+  virtual void text(std::string_view text) = 0;
+};
+
+/**
+ * @brief Streams an XML-file through a handler. The file is read in chunks of
+ * a fixed size and events are reported as soon as a tag or text is complete,
+ * so memory use is bounded by the largest tag or text instead of the size of
+ * the document. It supports the subset of XML that is used by PNML- and
+ * GRML-files: elements, attributes, text, comments, CDATA, processing
+ * instructions, doctype declarations and the predefined and numeric character
+ * references. It throws a std::runtime_error if the file can not be read or is
+ * malformed.
+ *
+ * @param path
+ * @param handler
+ */
+void parseXml(const std::string &path, XmlHandler &handler);
+
+}  // namespace symmetri